@@ -0,0 +1,4 @@
+#pragma once
+
+/* the software signer runs on the host: no device target, strlcpy and strlcat from libbsd */
+#include <bsd/string.h>
@@ -0,0 +1,233 @@
+/*
+ * Software signer on a pthread worker pool. The parser and formatter state (ctx, the formatter
+ * stack, the caches and the jobs) is thread local in the SOFTSIGN build, so each worker has its
+ * own review context and runs the device code unchanged.
+ */
+
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+
+#include "softsign.h"
+#include "stellar_api.h"
+#include "stellar_format.h"
+#include "stellar_jobs.h"
+#include "stellar_vars.h"
+
+APP_THREAD_LOCAL stellar_context_t ctx;
+
+/* where a THROW of the parser or the formatter lands, set while a worker reviews an envelope */
+static APP_THREAD_LOCAL jmp_buf *throwTarget;
+
+void softsign_throw(unsigned short code) {
+    if (throwTarget == NULL) {
+        fprintf(stderr, "softsign: error 0x%04x outside of a review\n", code);
+        abort();
+    }
+    longjmp(*throwTarget, code);
+}
+
+struct softsign_pool {
+    EVP_PKEY *key;
+    unsigned int workerCount;
+    pthread_t *workers;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    bool stop;
+
+    // the batch being signed
+    uint64_t generation;
+    const softsign_envelope_t *envelopes;
+    softsign_result_t *results;
+    size_t count;
+    size_t next;          // next envelope to take, shared by the workers
+    unsigned int active;  // workers still working on the batch
+    softsign_review_t review;
+    void *arg;
+};
+
+/*
+ * walks the review screens as the device shows them. Unlike the device, which still shows what it
+ * could parse, nobody looks at the screens here: a review that stops early is not signed.
+ */
+static bool review_tx(tx_context_t *txCtx, const softsign_pool_t *pool, size_t index) {
+    uint8_t opCount = txCtx->opCount;
+    uint16_t screenCount;
+    uint16_t screens = 0;
+
+    if (!get_transaction_screen_count(txCtx, &screenCount)) {
+        return false;
+    }
+
+    formatter_index = 0;
+    MEMCLEAR(formatter_stack);
+    current_data_index = 0;
+    set_state_data(true);
+    while ((opCount != 0 && current_data_index < opCount) ||
+           formatter_stack[formatter_index] != NULL) {
+        if (pool->review != NULL) {
+            pool->review(pool->arg, index, detailCaption, detailValue);
+        }
+        screens++;
+        formatter_index++;
+        if (formatter_stack[formatter_index] != NULL) {
+            set_state_data(true);
+        }
+    }
+
+    pool->results[index].screenCount = screens;
+    return screens == screenCount;
+}
+
+static uint16_t sign_tx(const softsign_pool_t *pool, size_t index) {
+    const softsign_envelope_t *envelope = &pool->envelopes[index];
+    softsign_result_t *result = &pool->results[index];
+    tx_context_t *txCtx = &ctx.req.tx;
+
+    if (envelope->rawLength > MAX_RAW_TX) {
+        return 0x6700;
+    }
+
+    MEMCLEAR(ctx);
+    jobs_clear();
+    ctx.reqType = CONFIRM_TRANSACTION;
+    ctx.state = STATE_APPROVE_TX;
+    txCtx->pathCount = 1;
+    txCtx->rawLength = envelope->rawLength;
+    memcpy(txCtx->raw, envelope->raw, envelope->rawLength);
+    SHA256(txCtx->raw, txCtx->rawLength, txCtx->hash);
+    memcpy(result->hash, txCtx->hash, HASH_SIZE);
+
+    // a THROW stops the review there, as the device would reply with an error
+    jmp_buf target;
+    if (setjmp(target) != 0) {
+        throwTarget = NULL;
+        return 0x6800;
+    }
+    throwTarget = &target;
+    bool reviewed =
+        parse_tx_xdr(txCtx->raw, txCtx->rawLength, txCtx) && review_tx(txCtx, pool, index);
+    throwTarget = NULL;
+    if (!reviewed) {
+        return 0x6800;
+    }
+
+    // background jobs only prefetch the screens, they are not needed here
+    jobs_clear();
+
+    size_t signatureLength = sizeof(result->signature);
+    EVP_MD_CTX *md = EVP_MD_CTX_new();
+    bool ok = md != NULL && EVP_DigestSignInit(md, NULL, NULL, NULL, pool->key) == 1 &&
+              EVP_DigestSign(md, result->signature, &signatureLength, txCtx->hash, HASH_SIZE) == 1;
+    EVP_MD_CTX_free(md);
+    return ok ? 0x9000 : 0x6f00;
+}
+
+static void *worker_main(void *param) {
+    softsign_pool_t *pool = param;
+    uint64_t generation = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stop && pool->generation == generation) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->stop) {
+            break;
+        }
+        generation = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        size_t index;
+        while ((index = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED)) < pool->count) {
+            softsign_result_t *result = &pool->results[index];
+            memset(result, 0, sizeof(*result));
+            result->sw = sign_tx(pool, index);
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->active == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    MEMCLEAR(ctx);
+    return NULL;
+}
+
+softsign_pool_t *softsign_pool_new(const uint8_t *privateKey, unsigned int workers) {
+    if (workers == 0) {
+        return NULL;
+    }
+    softsign_pool_t *pool = calloc(1, sizeof(softsign_pool_t));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->key = EVP_PKEY_new_raw_private_key(EVP_PKEY_ED25519, NULL, privateKey, 32);
+    pool->workers = calloc(workers, sizeof(pthread_t));
+    if (pool->key == NULL || pool->workers == NULL) {
+        softsign_pool_free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (; pool->workerCount < workers; pool->workerCount++) {
+        if (pthread_create(&pool->workers[pool->workerCount], NULL, worker_main, pool) != 0) {
+            softsign_pool_free(pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+void softsign_pool_free(softsign_pool_t *pool) {
+    if (pool == NULL) {
+        return;
+    }
+    if (pool->workers != NULL && pool->key != NULL) {
+        pthread_mutex_lock(&pool->lock);
+        pool->stop = true;
+        pthread_cond_broadcast(&pool->start);
+        pthread_mutex_unlock(&pool->lock);
+        for (unsigned int i = 0; i < pool->workerCount; i++) {
+            pthread_join(pool->workers[i], NULL);
+        }
+        pthread_cond_destroy(&pool->done);
+        pthread_cond_destroy(&pool->start);
+        pthread_mutex_destroy(&pool->lock);
+    }
+    EVP_PKEY_free(pool->key);
+    free(pool->workers);
+    free(pool);
+}
+
+void softsign_batch(softsign_pool_t *pool,
+                    const softsign_envelope_t *envelopes,
+                    softsign_result_t *results,
+                    size_t count,
+                    softsign_review_t review,
+                    void *arg) {
+    pthread_mutex_lock(&pool->lock);
+    pool->envelopes = envelopes;
+    pool->results = results;
+    pool->count = count;
+    pool->next = 0;
+    pool->review = review;
+    pool->arg = arg;
+    pool->active = pool->workerCount;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    while (pool->active != 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
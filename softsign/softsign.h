@@ -0,0 +1,45 @@
+#pragma once
+
+/*
+ * Software signer: parses, reviews and signs transaction envelopes with the code the device runs,
+ * so that the policy and the review screens of a hot wallet match the hardware signer.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "stellar_types.h"
+
+typedef struct {
+    const uint8_t *raw;  // network id, then the transaction envelope, as sent to the device
+    uint32_t rawLength;
+} softsign_envelope_t;
+
+typedef struct {
+    uint16_t sw;           // status word the device would reply with, 0x9000 when signed
+    uint16_t screenCount;  // screens of the review
+    uint8_t hash[HASH_SIZE];
+    uint8_t signature[64];
+} softsign_result_t;
+
+/* called for each review screen, from the worker thread reviewing envelope index */
+typedef void (*softsign_review_t)(void *arg, size_t index, const char *caption, const char *value);
+
+typedef struct softsign_pool softsign_pool_t;
+
+/* starts worker threads signing with the ed25519 private key, NULL on failure */
+softsign_pool_t *softsign_pool_new(const uint8_t *privateKey, unsigned int workers);
+
+void softsign_pool_free(softsign_pool_t *pool);
+
+/*
+ * reviews and signs count envelopes on the workers, returns once results[] is complete.
+ * A pool runs one batch at a time. review may be NULL.
+ */
+void softsign_batch(softsign_pool_t *pool,
+                    const softsign_envelope_t *envelopes,
+                    softsign_result_t *results,
+                    size_t count,
+                    softsign_review_t review,
+                    void *arg);
@@ -26,6 +26,7 @@
 #include "stellar_api.h"
 #include "stellar_vars.h"
 #include "stellar_ux.h"
+#include "stellar_jobs.h"
 
 #include "swap/swap_lib_calls.h"
 
@@ -82,6 +83,10 @@ static void handle_apdu(uint8_t *buffer,
                     handle_get_public_key(p1, p2, dataBuffer, dataLength, flags, tx);
                     break;
 
+                case INS_GET_PUBLIC_KEYS:
+                    handle_get_public_keys(dataBuffer, dataLength, tx);
+                    break;
+
                 case INS_SIGN_TX:
                     handle_sign_tx(p1, p2, dataBuffer, dataLength, flags);
                     break;
@@ -90,6 +95,16 @@ static void handle_apdu(uint8_t *buffer,
                     handle_sign_tx_hash(dataBuffer, dataLength, flags);
                     break;
 
+                case INS_SIGN_TX_HASHES:
+                    handle_sign_tx_hashes(p1, p2, dataBuffer, dataLength, flags, tx);
+                    break;
+
+#ifdef HAVE_TX_QUEUE
+                case INS_QUEUE_TX:
+                    handle_queue_tx(p1, p2, dataBuffer, dataLength, tx);
+                    break;
+#endif
+
                 case INS_GET_APP_CONFIGURATION:
                     handle_get_app_configuration(tx);
                     break;
@@ -131,11 +146,16 @@ static void handle_apdu(uint8_t *buffer,
 }
 
 static void stellar_nv_state_init() {
+    nv_load();
     if (N_stellar_pstate.initialized != 0x01) {
         uint8_t initialized = 0x01;
-        nvm_write((void *) &N_stellar_pstate.initialized, &initialized, 1);
-        uint8_t hashSigning = 0x00;
-        nvm_write((void *) &N_stellar_pstate.hashSigning, &hashSigning, 1);
+        uint8_t disabled = 0x00;
+        nv_write(&N_stellar_pstate.initialized, &initialized, 1);
+        nv_write(&N_stellar_pstate.hashSigning, &disabled, 1);
+#ifdef HAVE_KEY_CACHES
+        nv_write(&N_stellar_pstate.pubkeyCaching, &disabled, 1);
+#endif
+        nv_commit();
     }
 }
 
@@ -268,6 +288,9 @@ unsigned char io_event(unsigned char channel) {
                 }
             }
 
+            // use the time the user spends reading the screen
+            jobs_run_slice();
+
             UX_TICKER_EVENT(G_io_seproxyhal_spi_buffer, {});
             break;
     }
@@ -282,6 +305,10 @@ unsigned char io_event(unsigned char channel) {
 }
 
 void app_exit(void) {
+    pubkey_cache_clear();
+#ifdef HAVE_KEY_CACHES
+    clear_nv_tag_key();
+#endif
     BEGIN_TRY_L(exit) {
         TRY_L(exit) {
             os_sched_exit(-1);
@@ -23,9 +23,26 @@
 #include "stellar_types.h"
 #include "stellar_vars.h"
 #include "stellar_ux.h"
+#include "stellar_jobs.h"
 
 #include "swap/swap_lib_calls.h"
 
+/*
+ * Private keys of the transaction under review. They are derived by a background job while the
+ * user reads the first screens, and only used once the transaction is approved.
+ */
+static cx_ecfp_private_key_t signingKeys[MAX_SIGNING_PATHS];
+static uint8_t signingKeysReady;
+
+#ifdef HAVE_KEY_CACHES
+/*
+ * Key of the tags of the persistent public key cache, derived from the seed once per session.
+ * Entries cached under another seed do not verify with it.
+ */
+static uint8_t nvTagKey[32];
+static bool nvTagKeyReady;
+#endif
+
 static void app_set_state(enum app_state_t state) {
     ctx.state = state;
 }
@@ -34,12 +51,17 @@ static enum app_state_t app_get_state() {
     return ctx.state;
 }
 
-int derive_private_key(cx_ecfp_private_key_t *privateKey, uint32_t *bip32, uint8_t bip32Len) {
+static int derive_node(cx_ecfp_private_key_t *privateKey,
+                       uint32_t *bip32,
+                       uint8_t bip32Len,
+                       bool heartbeat) {
     int error = 0;
     uint8_t privateKeyData[32];
     BEGIN_TRY {
         TRY {
-            io_seproxyhal_io_heartbeat();
+            if (heartbeat) {
+                io_seproxyhal_io_heartbeat();
+            }
             os_perso_derive_node_bip32_seed_key(HDW_ED25519_SLIP10,
                                                 CX_CURVE_Ed25519,
                                                 bip32,
@@ -48,7 +70,9 @@ int derive_private_key(cx_ecfp_private_key_t *privateKey, uint32_t *bip32, uint8
                                                 NULL,
                                                 (unsigned char *) "ed25519 seed",
                                                 12);
-            io_seproxyhal_io_heartbeat();
+            if (heartbeat) {
+                io_seproxyhal_io_heartbeat();
+            }
             cx_ecfp_init_private_key(CX_CURVE_Ed25519, privateKeyData, 32, privateKey);
         }
         CATCH_OTHER(e) {
@@ -64,6 +88,10 @@ int derive_private_key(cx_ecfp_private_key_t *privateKey, uint32_t *bip32, uint8
     return error;
 }
 
+int derive_private_key(cx_ecfp_private_key_t *privateKey, uint32_t *bip32, uint8_t bip32Len) {
+    return derive_node(privateKey, bip32, bip32Len, true);
+}
+
 int init_public_key(cx_ecfp_private_key_t *privateKey,
                     cx_ecfp_public_key_t *publicKey,
                     uint8_t *buffer) {
@@ -96,8 +124,222 @@ int init_public_key(cx_ecfp_private_key_t *privateKey,
     return 0;
 }
 
-void handle_get_app_configuration(volatile unsigned int *tx) {
+#ifdef HAVE_KEY_CACHES
+/* derive the tag key from the 44'/148' node: two hardened steps and no point multiplication */
+static int init_nv_tag_key(void) {
+    static const char domain[] = "stellar pubkey cache";
+    uint32_t bip32[2] = {0x8000002C, 0x80000094};
+    cx_ecfp_private_key_t privateKey;
+
+    if (nvTagKeyReady) {
+        return 0;
+    }
+    int error = derive_private_key(&privateKey, bip32, 2);
+    if (!error) {
+        cx_hmac_sha256(privateKey.d,
+                       32,
+                       (const uint8_t *) domain,
+                       sizeof(domain) - 1,
+                       nvTagKey,
+                       sizeof(nvTagKey));
+        nvTagKeyReady = true;
+    }
+    explicit_bzero(&privateKey, sizeof(privateKey));
+    return error;
+}
+
+void clear_nv_tag_key(void) {
+    explicit_bzero(nvTagKey, sizeof(nvTagKey));
+    nvTagKeyReady = false;
+}
+#endif
+
+int derive_public_key(uint32_t *bip32, uint8_t bip32Len, uint8_t *publicKey, bool persist) {
+    if (pubkey_cache_lookup(bip32, bip32Len, publicKey)) {
+        return 0;
+    }
+#ifdef HAVE_KEY_CACHES
+    bool nvCaching = N_stellar_pstate.pubkeyCaching && init_nv_tag_key() == 0;
+    if (nvCaching && nv_pubkey_cache_lookup(nvTagKey, bip32, bip32Len, publicKey, persist)) {
+        if (persist) {
+            pubkey_cache_store(bip32, bip32Len, publicKey);
+        }
+        return 0;
+    }
+#endif
+
+    cx_ecfp_private_key_t privateKey;
+    cx_ecfp_public_key_t publicKeyPoint;
+    int error = derive_private_key(&privateKey, bip32, bip32Len);
+    if (!error) {
+        error = init_public_key(&privateKey, &publicKeyPoint, publicKey);
+    }
+    explicit_bzero(&privateKey, sizeof(privateKey));
+    if (error) {
+        return error;
+    }
+
+#ifdef HAVE_KEY_CACHES
+    if (persist) {
+        pubkey_cache_store(bip32, bip32Len, publicKey);
+        if (nvCaching) {
+            nv_pubkey_cache_store(nvTagKey, bip32, bip32Len, publicKey);
+        }
+    }
+#else
+    (void) persist;
+#endif
+    return 0;
+}
+
+static int derive_signing_key(uint8_t i) {
+    if (i < signingKeysReady) {
+        return 0;
+    }
+    int error = derive_node(&signingKeys[i], ctx.req.tx.bip32[i], ctx.req.tx.bip32Len[i], false);
+    if (!error) {
+        signingKeysReady = i + 1;
+    }
+    return error;
+}
+
+static bool derive_signing_key_job(uint8_t step) {
+    // one key per slice, in path order
+    return derive_signing_key(step) != 0 || step + 1 >= ctx.req.tx.pathCount;
+}
+
+void clear_signing_key(void) {
+    explicit_bzero(signingKeys, sizeof(signingKeys));
+    signingKeysReady = 0;
+}
+
+/* signature hint: the last 4 bytes of the signer public key */
+static int get_signature_hint(uint8_t i, uint8_t *hint) {
+    uint8_t publicKey[32];
+    if (!pubkey_cache_lookup(ctx.req.tx.bip32[i], ctx.req.tx.bip32Len[i], publicKey)) {
+        cx_ecfp_private_key_t privateKey = signingKeys[i];
+        cx_ecfp_public_key_t publicKeyPoint;
+        int error = init_public_key(&privateKey, &publicKeyPoint, publicKey);
+        explicit_bzero(&privateKey, sizeof(privateKey));
+        if (error) {
+            return error;
+        }
+        pubkey_cache_store(ctx.req.tx.bip32[i], ctx.req.tx.bip32Len[i], publicKey);
+    }
+    memcpy(hint, publicKey + 28, 4);
+    return 0;
+}
+
+int sign_tx_hash(uint8_t *out) {
+    int error = 0;
+    uint32_t tx = 0;
+
+    // called from event handlers, where the heartbeat would dispatch events from inside them
+    for (uint8_t i = 0; i < ctx.req.tx.pathCount && !error; i++) {
+        error = derive_signing_key(i);
+        if (!error && ctx.req.tx.multiPath) {
+            error = get_signature_hint(i, out + tx);
+            tx += 4;
+        }
+        if (error) {
+            break;
+        }
+
+        BEGIN_TRY {
+            TRY {
+                tx += cx_eddsa_sign(&signingKeys[i],
+                                    CX_LAST,
+                                    CX_SHA512,
+                                    ctx.req.tx.hash,
+                                    HASH_SIZE,
+                                    NULL,
+                                    0,
+                                    out + tx,
+                                    64,
+                                    NULL);
+            }
+            CATCH_OTHER(e) {
+                error = e;
+            }
+            FINALLY {
+            }
+        }
+        END_TRY;
+    }
+
+    clear_signing_key();
+    ctx.req.tx.tx = error ? 0 : tx;
+    return error;
+}
+
+int sign_next_hashes(void) {
+    uint8_t count = ctx.req.tx.hashCount - ctx.req.tx.signedCount;
+    if (count > MAX_SIGNATURES_PER_APDU) {
+        count = MAX_SIGNATURES_PER_APDU;
+    }
+
+    int error = derive_signing_key(0);
+    uint32_t tx = 0;
+    for (uint8_t i = 0; i < count && !error; i++) {
+        const uint8_t *hash = ctx.req.tx.raw + (ctx.req.tx.signedCount + i) * HASH_SIZE;
+        BEGIN_TRY {
+            TRY {
+                tx += cx_eddsa_sign(&signingKeys[0],
+                                    CX_LAST,
+                                    CX_SHA512,
+                                    hash,
+                                    HASH_SIZE,
+                                    NULL,
+                                    0,
+                                    G_io_apdu_buffer + tx,
+                                    64,
+                                    NULL);
+            }
+            CATCH_OTHER(e) {
+                error = e;
+            }
+            FINALLY {
+            }
+        }
+        END_TRY;
+    }
+
+    ctx.req.tx.signedCount += count;
+    if (error || ctx.req.tx.signedCount == ctx.req.tx.hashCount) {
+        // the key outlives the approval only while signatures remain to be sent
+        clear_signing_key();
+        app_set_state(STATE_NONE);
+    }
+    ctx.req.tx.tx = error ? 0 : tx;
+    return error;
+}
+
+/*
+ * Any other command ends the request under review, or a batch whose signatures were not all
+ * fetched: its hashes, keys and jobs must not outlive it.
+ */
+static void end_tx_request(void) {
     app_set_state(STATE_NONE);
+    jobs_clear();
+    clear_signing_key();
+    MEMCLEAR(ctx.req.tx);
+}
+
+/* a new request replaces the one under review */
+static void start_tx_request(enum app_state_t state) {
+    end_tx_request();
+    app_set_state(state);
+    ctx.reqType = CONFIRM_TRANSACTION;
+}
+
+/* drop what was received of a request before reporting sw, so that none of it can be approved */
+static void abort_tx_request(unsigned short sw) {
+    end_tx_request();
+    THROW(sw);
+}
+
+void handle_get_app_configuration(volatile unsigned int *tx) {
+    end_tx_request();
 
     G_io_apdu_buffer[0] = N_stellar_pstate.hashSigning;
     G_io_apdu_buffer[1] = LEDGER_MAJOR_VERSION;
@@ -123,7 +365,7 @@ void handle_get_public_key(uint8_t p1,
                            uint16_t dataLength,
                            volatile unsigned int *flags,
                            volatile unsigned int *tx) {
-    app_set_state(STATE_NONE);
+    end_tx_request();
 
     if ((p1 != P1_SIGNATURE) && (p1 != P1_NO_SIGNATURE)) {
         THROW(0x6B00);
@@ -161,15 +403,21 @@ void handle_get_public_key(uint8_t p1,
         memcpy(msg, dataBuffer, msgLength);
     }
 
-    cx_ecfp_private_key_t privateKey;
-    cx_ecfp_public_key_t publicKey;
-    derive_private_key(&privateKey, bip32, bip32Len);
-    init_public_key(&privateKey, &publicKey, ctx.req.pk.publicKey);
-
     int error = 0;
-    BEGIN_TRY {
-        TRY {
-            if (ctx.req.pk.returnSignature) {
+    if (!ctx.req.pk.returnSignature) {
+        // a public key alone never needs the seed once the path has been derived
+        error = derive_public_key(bip32, bip32Len, ctx.req.pk.publicKey, true);
+        if (error) {
+            THROW(error);
+        }
+    } else {
+        cx_ecfp_private_key_t privateKey;
+        cx_ecfp_public_key_t publicKey;
+        derive_private_key(&privateKey, bip32, bip32Len);
+        init_public_key(&privateKey, &publicKey, ctx.req.pk.publicKey);
+
+        BEGIN_TRY {
+            TRY {
                 io_seproxyhal_io_heartbeat();
                 cx_eddsa_sign(&privateKey,
                               CX_LAST,
@@ -183,18 +431,19 @@ void handle_get_public_key(uint8_t p1,
                               NULL);
                 io_seproxyhal_io_heartbeat();
             }
+            CATCH_OTHER(e) {
+                error = e;
+            }
+            FINALLY {
+                explicit_bzero(&privateKey, sizeof(privateKey));
+            }
         }
-        CATCH_OTHER(e) {
-            error = e;
-        }
-        FINALLY {
-            explicit_bzero(&privateKey, sizeof(privateKey));
-        }
-    }
-    END_TRY;
+        END_TRY;
 
-    if (error) {
-        THROW(error);
+        if (error) {
+            THROW(error);
+        }
+        pubkey_cache_store(bip32, bip32Len, ctx.req.pk.publicKey);
     }
 
     uint32_t pk_tx = set_result_get_public_key();
@@ -209,34 +458,91 @@ void handle_get_public_key(uint8_t p1,
     }
 }
 
+/*
+ * Account discovery: the base path is followed by a 4 bytes big endian start index and a count.
+ * Keys for base/start', base/(start+1)', ... are returned after a byte holding how many of them
+ * fit in the response, the host asks for the rest starting from the next index.
+ */
+void handle_get_public_keys(uint8_t *dataBuffer, uint16_t dataLength, volatile unsigned int *tx) {
+    end_tx_request();
+
+    if (dataLength < 1) {
+        THROW(0x6a80);
+    }
+    uint32_t bip32[MAX_BIP32_LEN];
+    uint8_t bip32Len = *dataBuffer;
+    if (bip32Len >= MAX_BIP32_LEN || dataLength != 1 + bip32Len * 4 + 4 + 1 ||
+        !parse_bip32_path(dataBuffer + 1, bip32Len, bip32, MAX_BIP32_LEN)) {
+        PRINTF("Invalid path\n");
+        THROW(0x6a80);
+    }
+    dataBuffer += 1 + bip32Len * 4;
+
+    uint32_t index = U4BE(dataBuffer, 0);
+    uint8_t count = dataBuffer[4];
+    if (count == 0 || (index & 0x80000000) != 0 || (uint32_t) count - 1 > 0x7FFFFFFF - index) {
+        THROW(0x6a80);
+    }
+    if (count > MAX_PUBLIC_KEYS_PER_APDU) {
+        count = MAX_PUBLIC_KEYS_PER_APDU;
+    }
+
+    uint32_t offset = 1;
+    for (uint8_t i = 0; i < count; i++) {
+        bip32[bip32Len] = 0x80000000 | (index + i);
+        // discovery scans many accounts, none of them may evict the ones in use
+        int error = derive_public_key(bip32, bip32Len + 1, G_io_apdu_buffer + offset, false);
+        if (error) {
+            THROW(error);
+        }
+        offset += 32;
+        io_seproxyhal_io_heartbeat();
+    }
+    G_io_apdu_buffer[0] = count;
+    *tx = offset;
+    THROW(0x9000);
+}
+
 void handle_sign_tx(uint8_t p1,
                     uint8_t p2,
                     uint8_t *dataBuffer,
                     uint16_t dataLength,
                     volatile unsigned int *flags) {
-    if ((p1 != P1_FIRST) && (p1 != P1_MORE)) {
+    if ((p1 != P1_FIRST) && (p1 != P1_FIRST_MULTI_PATH) && (p1 != P1_MORE)) {
         THROW(0x6B00);
     }
     if ((p2 != P2_LAST) && (p2 != P2_MORE)) {
         THROW(0x6B00);
     }
 
-    if (p1 == P1_FIRST) {
-        app_set_state(STATE_PARSE_TX);
-
-        MEMCLEAR(ctx.req.tx);
-        ctx.reqType = CONFIRM_TRANSACTION;
-        // read the bip32 path
-        ctx.req.tx.bip32Len = *dataBuffer;
-        if (!parse_bip32_path(dataBuffer + 1,
-                              ctx.req.tx.bip32Len,
-                              ctx.req.tx.bip32,
-                              MAX_BIP32_LEN)) {
-            PRINTF("Invalid path\n");
-            THROW(0x6a80);
+    if (p1 != P1_MORE) {
+        start_tx_request(STATE_PARSE_TX);
+
+        // read the path count of a multi path request, then the bip32 paths
+        ctx.req.tx.multiPath = (p1 == P1_FIRST_MULTI_PATH);
+        ctx.req.tx.pathCount = 1;
+        if (ctx.req.tx.multiPath) {
+            ctx.req.tx.pathCount = *dataBuffer;
+            if (dataLength < 1 || ctx.req.tx.pathCount == 0 ||
+                ctx.req.tx.pathCount > MAX_SIGNING_PATHS) {
+                abort_tx_request(0x6a80);
+            }
+            dataBuffer += 1;
+            dataLength -= 1;
+        }
+        for (uint8_t i = 0; i < ctx.req.tx.pathCount; i++) {
+            ctx.req.tx.bip32Len[i] = *dataBuffer;
+            if (dataLength < 1 + ctx.req.tx.bip32Len[i] * 4 ||
+                !parse_bip32_path(dataBuffer + 1,
+                                  ctx.req.tx.bip32Len[i],
+                                  ctx.req.tx.bip32[i],
+                                  MAX_BIP32_LEN)) {
+                PRINTF("Invalid path\n");
+                abort_tx_request(0x6a80);
+            }
+            dataBuffer += 1 + ctx.req.tx.bip32Len[i] * 4;
+            dataLength -= 1 + ctx.req.tx.bip32Len[i] * 4;
         }
-        dataBuffer += 1 + ctx.req.tx.bip32Len * 4;
-        dataLength -= 1 + ctx.req.tx.bip32Len * 4;
 
         // read raw tx data
         ctx.req.tx.rawLength = dataLength;
@@ -250,7 +556,7 @@ void handle_sign_tx(uint8_t p1,
         uint32_t offset = ctx.req.tx.rawLength;
         ctx.req.tx.rawLength += dataLength;
         if (ctx.req.tx.rawLength > MAX_RAW_TX) {
-            THROW(0x6700);
+            abort_tx_request(0x6700);
         }
         memcpy(ctx.req.tx.raw + offset, dataBuffer, dataLength);
     }
@@ -259,84 +565,290 @@ void handle_sign_tx(uint8_t p1,
         THROW(0x9000);
     }
 
-    cx_hash_sha256(ctx.req.tx.raw, ctx.req.tx.rawLength, ctx.req.tx.hash, HASH_SIZE);
-
     if (!parse_tx_xdr(ctx.req.tx.raw, ctx.req.tx.rawLength, &ctx.req.tx)) {
-        THROW(0x6800);
-    }
-
-    cx_ecfp_private_key_t privateKey;
-    derive_private_key(&privateKey, ctx.req.tx.bip32, ctx.req.tx.bip32Len);
-
-    int error = 0;
-    BEGIN_TRY {
-        TRY {
-            // sign hash
-            io_seproxyhal_io_heartbeat();
-            ctx.req.tx.tx = cx_eddsa_sign(&privateKey,
-                                          CX_LAST,
-                                          CX_SHA512,
-                                          ctx.req.tx.hash,
-                                          HASH_SIZE,
-                                          NULL,
-                                          0,
-                                          G_io_apdu_buffer,
-                                          64,
-                                          NULL);
-            io_seproxyhal_io_heartbeat();
-        }
-        CATCH_OTHER(e) {
-            error = e;
-        }
-        FINALLY {
-            explicit_bzero(&privateKey, sizeof(privateKey));
-        }
-    }
-    END_TRY;
-
-    if (error) {
-        THROW(error);
+        abort_tx_request(0x6800);
     }
+    // only the hash of an envelope that parsed, and goes to review, can be signed
+    cx_hash_sha256(ctx.req.tx.raw, ctx.req.tx.rawLength, ctx.req.tx.hash, HASH_SIZE);
+    app_set_state(STATE_APPROVE_TX);
 
     if (called_from_swap) {
         swap_check();
         os_sched_exit(0);
     }
     ui_approve_tx_init();
+    // the signature is computed on approval, derive the key while the user reviews
+    jobs_schedule(&derive_signing_key_job);
 
     *flags |= IO_ASYNCH_REPLY;
-    app_set_state(STATE_APPROVE_TX);
 }
 
 void handle_sign_tx_hash(uint8_t *dataBuffer, uint16_t dataLength, volatile unsigned int *flags) {
-    app_set_state(STATE_NONE);
+    start_tx_request(STATE_NONE);
 
     if (!N_stellar_pstate.hashSigning) {
         THROW(0x6c66);
     }
 
-    MEMCLEAR(ctx.req.tx);
-    ctx.reqType = CONFIRM_TRANSACTION;
-
-    ctx.req.tx.bip32Len = *dataBuffer;
-    if (!parse_bip32_path(dataBuffer + 1, ctx.req.tx.bip32Len, ctx.req.tx.bip32, MAX_BIP32_LEN)) {
+    ctx.req.tx.pathCount = 1;
+    ctx.req.tx.bip32Len[0] = *dataBuffer;
+    if (!parse_bip32_path(dataBuffer + 1,
+                          ctx.req.tx.bip32Len[0],
+                          ctx.req.tx.bip32[0],
+                          MAX_BIP32_LEN)) {
         PRINTF("Invalid path\n");
-        THROW(0x6a80);
+        abort_tx_request(0x6a80);
     }
-    dataBuffer += 1 + ctx.req.tx.bip32Len * 4;
-    dataLength -= 1 + ctx.req.tx.bip32Len * 4;
+    dataBuffer += 1 + ctx.req.tx.bip32Len[0] * 4;
+    dataLength -= 1 + ctx.req.tx.bip32Len[0] * 4;
 
     if (dataLength != 32) {
-        THROW(0x6a80);
+        abort_tx_request(0x6a80);
     }
     memcpy(ctx.req.tx.hash, dataBuffer, dataLength);
 
     ui_approve_tx_hash_init();
+    jobs_schedule(&derive_signing_key_job);
 
     *flags |= IO_ASYNCH_REPLY;
     app_set_state(STATE_APPROVE_TX_HASH);
 }
 
+/*
+ * Batch hash signing: the chunks carry the bip32 path, then the hashes. After a single approval
+ * the response holds the first signatures, the host fetches the others with P1_NEXT_SIGNATURES.
+ */
+void handle_sign_tx_hashes(uint8_t p1,
+                           uint8_t p2,
+                           uint8_t *dataBuffer,
+                           uint16_t dataLength,
+                           volatile unsigned int *flags,
+                           volatile unsigned int *tx) {
+    if (!N_stellar_pstate.hashSigning) {
+        abort_tx_request(0x6c66);
+    }
+    if ((p1 != P1_FIRST) && (p1 != P1_MORE) && (p1 != P1_NEXT_SIGNATURES)) {
+        abort_tx_request(0x6B00);
+    }
+    if ((p2 != P2_LAST) && (p2 != P2_MORE)) {
+        abort_tx_request(0x6B00);
+    }
+
+    if (p1 == P1_NEXT_SIGNATURES) {
+        if (app_get_state() != STATE_SEND_SIGNATURES) {
+            abort_tx_request(0x6985);
+        }
+        int error = sign_next_hashes();
+        if (error) {
+            abort_tx_request(error);
+        }
+        *tx = ctx.req.tx.tx;
+        THROW(0x9000);
+    }
+
+    if (p1 == P1_FIRST) {
+        start_tx_request(STATE_PARSE_TX);
+        ctx.req.tx.pathCount = 1;
+        ctx.req.tx.bip32Len[0] = *dataBuffer;
+        if (dataLength < 1 + ctx.req.tx.bip32Len[0] * 4 ||
+            !parse_bip32_path(dataBuffer + 1,
+                              ctx.req.tx.bip32Len[0],
+                              ctx.req.tx.bip32[0],
+                              MAX_BIP32_LEN)) {
+            PRINTF("Invalid path\n");
+            abort_tx_request(0x6a80);
+        }
+        dataBuffer += 1 + ctx.req.tx.bip32Len[0] * 4;
+        dataLength -= 1 + ctx.req.tx.bip32Len[0] * 4;
+    } else if (app_get_state() != STATE_PARSE_TX) {
+        abort_tx_request(0x6700);
+    }
+
+    // read more hashes
+    if (dataLength % HASH_SIZE != 0 || ctx.req.tx.hashCount + dataLength / HASH_SIZE > MAX_HASHES) {
+        abort_tx_request(0x6700);
+    }
+    memcpy(ctx.req.tx.raw + ctx.req.tx.rawLength, dataBuffer, dataLength);
+    ctx.req.tx.rawLength += dataLength;
+    ctx.req.tx.hashCount += dataLength / HASH_SIZE;
+
+    if (p2 == P2_MORE) {
+        THROW(0x9000);
+    }
+    if (ctx.req.tx.hashCount == 0) {
+        abort_tx_request(0x6a80);
+    }
+
+    // the user approves the list through its digest, the host shows the same one
+    cx_hash_sha256(ctx.req.tx.raw, ctx.req.tx.rawLength, ctx.req.tx.hash, HASH_SIZE);
+
+    app_set_state(STATE_APPROVE_TX_HASHES);
+    ui_approve_tx_hash_init();
+    jobs_schedule(&derive_signing_key_job);
+
+    *flags |= IO_ASYNCH_REPLY;
+}
+
+#ifdef HAVE_TX_QUEUE
+/*
+ * Queued session: the host uploads the next envelope into the staging slot while the user reviews
+ * the current one, and polls for the results. Envelopes are reviewed back to back.
+ */
+typedef struct {
+    uint8_t id;
+    uint8_t status;
+    uint8_t signature[64];
+} queue_result_t;
+
+static struct {
+    bool filling;    // chunks of the staged envelope are being received
+    bool staged;     // the staging slot holds a complete envelope
+    bool reviewing;  // a queued envelope is under review
+    uint8_t nextId;
+    uint8_t stagedId;
+    uint8_t bip32Len;
+    uint32_t bip32[MAX_BIP32_LEN];
+    uint8_t raw[MAX_RAW_TX];
+    uint32_t rawLength;
+    queue_result_t results[QUEUE_RESULTS];
+    uint8_t resultCount;
+} queue;
+
+static void queue_push_result(uint8_t id, uint8_t status) {
+    queue_result_t *result = &queue.results[queue.resultCount++];
+    result->id = id;
+    result->status = status;
+}
+
+/* start the review of the staged envelope, if any and there is room for its result */
+static bool queue_review_next(void) {
+    if (queue.reviewing || !queue.staged || queue.resultCount == QUEUE_RESULTS) {
+        return false;
+    }
+
+    start_tx_request(STATE_PARSE_TX);
+    ctx.req.tx.queued = true;
+    ctx.req.tx.queueId = queue.stagedId;
+    ctx.req.tx.pathCount = 1;
+    ctx.req.tx.bip32Len[0] = queue.bip32Len;
+    memcpy(ctx.req.tx.bip32[0], queue.bip32, sizeof(queue.bip32));
+    memcpy(ctx.req.tx.raw, queue.raw, queue.rawLength);
+    ctx.req.tx.rawLength = queue.rawLength;
+    queue.staged = false;
+
+    if (!parse_tx_xdr(ctx.req.tx.raw, ctx.req.tx.rawLength, &ctx.req.tx)) {
+        queue_push_result(ctx.req.tx.queueId, QUEUE_STATUS_INVALID);
+        end_tx_request();
+        return false;
+    }
+
+    // only the hash of an envelope that parsed, and goes to review, can be signed
+    cx_hash_sha256(ctx.req.tx.raw, ctx.req.tx.rawLength, ctx.req.tx.hash, HASH_SIZE);
+    app_set_state(STATE_APPROVE_TX);
+    queue.reviewing = true;
+    ui_approve_tx_init();
+    jobs_schedule(&derive_signing_key_job);
+    return true;
+}
+
+void queue_review_done(bool approved) {
+    if (!queue.reviewing) {
+        // already reported, the screen outlived its review
+        return;
+    }
+    queue_result_t *result = &queue.results[queue.resultCount];
+    queue_push_result(ctx.req.tx.queueId, QUEUE_STATUS_REJECTED);
+    queue.reviewing = false;
+    if (approved && ctx.state == STATE_APPROVE_TX) {
+        // not into the APDU buffer, the next command may be arriving in it
+        result->status =
+            sign_tx_hash(result->signature) ? QUEUE_STATUS_INVALID : QUEUE_STATUS_SIGNED;
+    }
+    end_tx_request();
+
+    if (!queue_review_next()) {
+        ui_idle();
+    }
+}
+
+void queue_clear(void) {
+    explicit_bzero(&queue, sizeof(queue));
+}
+
+void handle_queue_tx(uint8_t p1,
+                     uint8_t p2,
+                     uint8_t *dataBuffer,
+                     uint16_t dataLength,
+                     volatile unsigned int *tx) {
+    if ((p1 != P1_FIRST) && (p1 != P1_MORE) && (p1 != P1_POLL)) {
+        THROW(0x6B00);
+    }
+    if ((p2 != P2_LAST) && (p2 != P2_MORE)) {
+        THROW(0x6B00);
+    }
+
+    if (p1 == P1_POLL) {
+        // oldest result first: status, id and the signature once signed
+        G_io_apdu_buffer[0] = QUEUE_STATUS_PENDING;
+        *tx = 1;
+        if (queue.resultCount > 0) {
+            queue_result_t *result = &queue.results[0];
+            G_io_apdu_buffer[0] = result->status;
+            G_io_apdu_buffer[1] = result->id;
+            *tx = 2;
+            if (result->status == QUEUE_STATUS_SIGNED) {
+                memcpy(G_io_apdu_buffer + 2, result->signature, 64);
+                *tx += 64;
+            }
+            queue.resultCount--;
+            memmove(&queue.results[0], &queue.results[1], queue.resultCount * sizeof(*result));
+            explicit_bzero(&queue.results[queue.resultCount], sizeof(*result));
+            queue_review_next();
+        }
+        THROW(0x9000);
+    }
+
+    if (p1 == P1_FIRST) {
+        if (queue.staged) {
+            // the staging slot frees up when its envelope goes to review
+            THROW(0x6a84);
+        }
+        queue.filling = false;
+        queue.bip32Len = *dataBuffer;
+        if (dataLength < 1 + queue.bip32Len * 4 ||
+            !parse_bip32_path(dataBuffer + 1, queue.bip32Len, queue.bip32, MAX_BIP32_LEN)) {
+            PRINTF("Invalid path\n");
+            THROW(0x6a80);
+        }
+        dataBuffer += 1 + queue.bip32Len * 4;
+        dataLength -= 1 + queue.bip32Len * 4;
+        queue.rawLength = 0;
+        queue.filling = true;
+    } else if (!queue.filling) {
+        THROW(0x6700);
+    }
+
+    if (queue.rawLength + dataLength > MAX_RAW_TX) {
+        queue.filling = false;
+        THROW(0x6700);
+    }
+    memcpy(queue.raw + queue.rawLength, dataBuffer, dataLength);
+    queue.rawLength += dataLength;
+
+    if (p2 == P2_MORE) {
+        THROW(0x9000);
+    }
+
+    queue.filling = false;
+    queue.staged = true;
+    queue.stagedId = queue.nextId++;
+    G_io_apdu_buffer[0] = queue.stagedId;
+    *tx = 1;
+    queue_review_next();
+    THROW(0x9000);
+}
+#endif
+
 void handle_keep_alive(volatile unsigned int *flags) {
     *flags |= IO_ASYNCH_REPLY;
 }
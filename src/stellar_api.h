@@ -19,7 +19,7 @@
 
 #include "stellar_types.h"
 
-#ifndef TEST
+#if !defined(TEST) && !defined(SOFTSIGN)
 #include "os.h"
 #include "cx.h"
 #endif
@@ -44,6 +44,9 @@ void handle_get_public_key(uint8_t p1,
                            volatile unsigned int *flags,
                            volatile unsigned int *tx);
 
+/** handles batched get public keys request (consecutive hardened indexes under a base path) */
+void handle_get_public_keys(uint8_t *dataBuffer, uint16_t dataLength, volatile unsigned int *tx);
+
 /** handles sign transaction request (displays transaction details) */
 void handle_sign_tx(uint8_t p1,
                     uint8_t p2,
@@ -54,6 +57,29 @@ void handle_sign_tx(uint8_t p1,
 /** handles sign transaction hash request (displays only transaction hash) */
 void handle_sign_tx_hash(uint8_t *dataBuffer, uint16_t dataLength, volatile unsigned int *flags);
 
+/** handles batch hash signing request (displays the number of hashes and their digest) */
+void handle_sign_tx_hashes(uint8_t p1,
+                           uint8_t p2,
+                           uint8_t *dataBuffer,
+                           uint16_t dataLength,
+                           volatile unsigned int *flags,
+                           volatile unsigned int *tx);
+
+#ifdef HAVE_TX_QUEUE
+/** handles queued session request (uploads the next transaction, or polls for results) */
+void handle_queue_tx(uint8_t p1,
+                     uint8_t p2,
+                     uint8_t *dataBuffer,
+                     uint16_t dataLength,
+                     volatile unsigned int *tx);
+
+/** record the outcome of the queued transaction under review and start the next one */
+void queue_review_done(bool approved);
+
+/** drop the queued session */
+void queue_clear(void);
+#endif
+
 /** u2f keep alive */
 void handle_keep_alive(volatile unsigned int *flags);
 
@@ -80,11 +106,19 @@ typedef struct {
     off_t offset;
 } buffer_t;
 
+/** string under construction, appends never rescan it and stop at its capacity */
+typedef struct {
+    char *ptr;
+    size_t len;
+    size_t size;
+    bool truncated;
+} strbuf_t;
+
 // ------------------------------------------------------------------------- //
 //                                UTILITIES                                  //
 // ------------------------------------------------------------------------- //
 
-#ifndef TEST
+#if !defined(TEST) && !defined(SOFTSIGN)
 /**  derive a private key from a bip32 path */
 int derive_private_key(cx_ecfp_private_key_t *privateKey, uint32_t *bip32, uint8_t bip32Len);
 
@@ -94,27 +128,181 @@ int init_public_key(cx_ecfp_private_key_t *privateKey,
                     uint8_t *buffer);
 #endif
 
+/** sign the hash of the approved transaction, out holds a signature (and hint) per path */
+int sign_tx_hash(uint8_t *out);
+
+/** sign the next hashes of an approved batch into the APDU buffer */
+int sign_next_hashes(void);
+
+/** forget the private key derived for the transaction under review */
+void clear_signing_key(void);
+
+#ifdef HAVE_KEY_CACHES
+/** forget the key of the persistent public key cache tags */
+void clear_nv_tag_key(void);
+#endif
+
+/** public key of a bip32 path, from the session or persistent cache, or derived.
+ * persist caches a derived key and marks a persisted one used, false only reads the caches */
+int derive_public_key(uint32_t *bip32, uint8_t bip32Len, uint8_t *publicKey, bool persist);
+
+#ifdef HAVE_KEY_CACHES
+/** copy the cached public key of a bip32 path, false if it was not derived this session */
+bool pubkey_cache_lookup(const uint32_t *bip32, uint8_t bip32Len, uint8_t *publicKey);
+
+/** remember the public key of a bip32 path for the rest of the session */
+void pubkey_cache_store(const uint32_t *bip32, uint8_t bip32Len, const uint8_t *publicKey);
+
+/** forget the public keys derived this session */
+void pubkey_cache_clear(void);
+#else
+/* no session cache, every public key is derived */
+#define pubkey_cache_lookup(bip32, bip32Len, publicKey) false
+#define pubkey_cache_store(bip32, bip32Len, publicKey)
+#define pubkey_cache_clear()
+#endif
+
+/** load the RAM shadow of the persistent state: the snapshot, then the journal */
+void nv_load(void);
+
+/** change length bytes of the persistent state at field, in N_stellar_pstate, until nv_commit() */
+void nv_write(void *field, const void *value, size_t length);
+
+/** persist the changed bytes with one write: a journal append, or a snapshot when it is full */
+void nv_commit(void);
+
+#ifdef TEST
+#define NVM_PAGE_SIZE 64
+
+/* flash writes of the persistent state, for the host tests */
+typedef struct {
+    uint32_t commits;
+    uint32_t snapshots;  // commits written as a new snapshot
+    uint32_t writes;     // nvm_write() calls
+    uint32_t bytes;
+    uint32_t pages;  // NVM_PAGE_SIZE pages touched, from the start of the store
+    uint64_t commitNs;  // time spent in the commits
+} nv_stats_t;
+
+extern nv_stats_t nv_stats;
+#endif
+
+#ifdef HAVE_KEY_CACHES
+/** copy the persisted public key of a bip32 path, false if absent or its tag does not verify.
+ * markUsed makes the entry the last one to be evicted */
+bool nv_pubkey_cache_lookup(const uint8_t *tagKey,
+                            const uint32_t *bip32,
+                            uint8_t bip32Len,
+                            uint8_t *publicKey,
+                            bool markUsed);
+
+/** persist the public key of a bip32 path, tagged with tagKey, in place of the least recently
+ * used entry when the cache is full */
+void nv_pubkey_cache_store(const uint8_t *tagKey,
+                           const uint32_t *bip32,
+                           uint8_t bip32Len,
+                           const uint8_t *publicKey);
+
+/** erase the persisted public keys */
+void nv_pubkey_cache_clear(void);
+#endif
+
 /**  parse a bip32 path from a byte stream */
 bool parse_bip32_path(uint8_t *path,
                       size_t path_length,
                       uint32_t *path_parsed,
                       size_t path_parsed_length);
 
+/** start an empty string in the size bytes at ptr */
+void strbuf_init(strbuf_t *buf, char *ptr, size_t size);
+
+/** append str, or as much of it as fits */
+void strbuf_append(strbuf_t *buf, const char *str);
+
+/** append the len first characters of str, or as many as fit */
+void strbuf_append_n(strbuf_t *buf, const char *str, size_t len);
+
+/** CRC16-XModem checksum of a StrKey payload */
+uint16_t crc16(const uint8_t *data, size_t length);
+
+#ifdef TEST
+/** CRC16 variants: 16-entry table (default on device), 256-entry table, slicing-by-4 */
+uint16_t crc16_nibble(const uint8_t *data, size_t length);
+uint16_t crc16_byte(const uint8_t *data, size_t length);
+uint16_t crc16_slice4(const uint8_t *data, size_t length);
+#endif
+
 /**  base32 encode public key */
 void encode_public_key(const uint8_t *in, char *out);
 
+/** base32 encode n public keys, vectorized on hosts that support it */
+void encode_public_keys_bulk(const uint8_t (*keys)[32], size_t n, char (*out)[57]);
+
 /** base32 encode pre-auth transaction hash */
 void encode_pre_auth_key(const uint8_t *in, char *out);
 
 /** base32 encode sha256 hash */
 void encode_hash_x_key(const uint8_t *in, char *out);
 
+/** base32 encoded StrKey to raw key, false on a wrong length, version byte or checksum */
+bool decode_strkey(const char *in, uint8_t versionByte, uint8_t *out);
+
+/** decode n StrKeys, bit i of valid tells whether in[i] decoded, invalid keys are zeroed.
+ * valid must hold (n + 7) / 8 bytes */
+void decode_strkeys_bulk(const char (*in)[57],
+                         size_t n,
+                         uint8_t versionByte,
+                         uint8_t (*out)[32],
+                         uint8_t *valid);
+
+/** raw key to base32 encoded (summarized) StrKey, only the displayed characters are encoded */
+void print_strkey(const uint8_t *in,
+                  uint8_t versionByte,
+                  char *out,
+                  uint8_t numCharsL,
+                  uint8_t numCharsR);
+
+#ifdef HAVE_KEY_CACHES
+/** encode a StrKey ahead of time, so that printing it later is a copy */
+void strkey_cache_warm(const uint8_t *in, uint8_t versionByte);
+
+/** forget the StrKeys encoded ahead of time */
+void strkey_cache_clear(void);
+#endif
+
 /** raw public key to base32 encoded (summarized) address */
 void print_public_key(const uint8_t *in, char *out, uint8_t numCharsL, uint8_t numCharsR);
 
 /** output first numCharsL of input + last numCharsR of input separated by ".." */
 void print_summary(const char *in, char *out, uint8_t numCharsL, uint8_t numCharsR);
 
+/** raw bytes to uppercase hexadecimal, out must hold 2 * len + 1 characters */
+void print_hex(const uint8_t *in, size_t len, char *out);
+
+#ifdef HAVE_HOST_SIMD
+/** host SIMD hex encoders, return the number of input bytes encoded (whole blocks only) */
+size_t print_hex_ssse3(const uint8_t *in, size_t len, char *out);
+size_t print_hex_avx2(const uint8_t *in, size_t len, char *out);
+size_t print_hex_simd(const uint8_t *in, size_t len, char *out);
+
+/** host SIMD public key encoders, 16 keys at a time, return the number of keys encoded */
+size_t encode_public_keys_avx2(const uint8_t (*keys)[32], size_t n, char (*out)[57]);
+size_t encode_public_keys_simd(const uint8_t (*keys)[32], size_t n, char (*out)[57]);
+
+/** host SIMD StrKey decoders, 16 keys at a time, return the number of keys decoded.
+ * The validity bits of whole bytes are assigned */
+size_t decode_strkeys_avx2(const char (*in)[57],
+                           size_t n,
+                           uint8_t versionByte,
+                           uint8_t (*out)[32],
+                           uint8_t *valid);
+size_t decode_strkeys_simd(const char (*in)[57],
+                           size_t n,
+                           uint8_t versionByte,
+                           uint8_t (*out)[32],
+                           uint8_t *valid);
+#endif
+
 /** raw byte buffer to hexadecimal string representation.
  * len is length of input, provided output must be twice that size */
 void print_binary(const uint8_t *in, char *out, uint8_t len);
@@ -123,6 +311,10 @@ void print_binary(const uint8_t *in, char *out, uint8_t len);
  * len is length of input, provided output must be at least length 19 */
 void print_binary_summary(const uint8_t *in, char *out, uint8_t len);
 
+/** fixed-point integer to decimal string with scale fractional digits, trailing zeros removed.
+ * returns the length printed or -1 if out_len is too small */
+int print_decimal(uint64_t value, uint8_t scale, char *out, size_t out_len);
+
 /** raw amount integer to asset-qualified string representation */
 int print_amount(uint64_t amount,
                  const Asset *asset,
@@ -130,20 +322,41 @@ int print_amount(uint64_t amount,
                  char *out,
                  size_t out_len);
 
-/** concatenate assetCode and assetIssuer summary */
-void print_asset_t(const Asset *asset, uint8_t network_id, char *out, size_t out_len);
+/** append a raw amount, asset-qualified when asset is not NULL */
+void strbuf_append_amount(strbuf_t *buf, uint64_t amount, const Asset *asset, uint8_t network_id);
+
+/** price n/d to asset-qualified string representation, without 64-bit division */
+int print_price(const Price *price,
+                const Asset *asset,
+                uint8_t network_id,
+                uint8_t significant_digits,
+                char *out,
+                size_t out_len);
 
-/** asset name */
-int print_asset_name(const Asset *asset, uint8_t network_id, char *out, size_t out_len);
+/** append a price n/d, asset-qualified when asset is not NULL. returns -1 if d is 0 */
+int strbuf_append_price(strbuf_t *buf,
+                        const Price *price,
+                        const Asset *asset,
+                        uint8_t network_id,
+                        uint8_t significant_digits);
 
-/** concatenate code and issuer */
-void print_asset(const char *code, char *issuer, char *out, size_t out_len);
+/** append assetCode and assetIssuer summary */
+void print_asset_t(const Asset *asset, uint8_t network_id, strbuf_t *out);
 
-/** "XLM" or "native" depending on the network id */
-void print_native_asset_code(uint8_t network, char *out, size_t out_len);
+/** append asset name */
+int print_asset_name(const Asset *asset, uint8_t network_id, strbuf_t *out);
 
-/** string representation of flags present */
-void print_flags(uint32_t flags, char *out, size_t out_len);
+/** append code and issuer */
+void print_asset(const char *code, const char *issuer, strbuf_t *out);
+
+/** append "XLM" or "native" depending on the network id */
+void print_native_asset_code(uint8_t network, strbuf_t *out);
+
+/** append string representation of flags present */
+void print_flags(uint32_t flags, strbuf_t *out);
+
+/** append a bip32 path as 44'/148'/0', hardened indexes marked with ' */
+void print_bip32_path(const uint32_t *path, uint8_t pathLen, strbuf_t *out);
 
 /** integer to string for display of sequence number */
 int print_int(int64_t l, char *out, size_t out_len);
@@ -151,7 +364,20 @@ int print_int(int64_t l, char *out, size_t out_len);
 /** integer to string for display of offerid, sequence number, threshold weights, etc */
 int print_uint(uint64_t l, char *out, size_t out_len);
 
-/** base64 encoding function used to display managed data values */
+/** append a signed integer */
+void strbuf_append_int(strbuf_t *buf, int64_t l);
+
+/** append an unsigned integer */
+void strbuf_append_uint(strbuf_t *buf, uint64_t l);
+
+/** base64 encoding function, out must hold 4 * ((inLen + 2) / 3) + 1 characters */
 void base64_encode(const uint8_t *data, int inLen, char *out);
 
+/** summarized base64 encoding of managed data values, only the displayed characters are encoded */
+void print_base64_summary(const uint8_t *data,
+                          size_t len,
+                          char *out,
+                          uint8_t numCharsL,
+                          uint8_t numCharsR);
+
 #endif
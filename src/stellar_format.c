@@ -3,13 +3,73 @@
 #include "stellar_format.h"
 #include "stellar_vars.h"
 #include "stellar_api.h"
-
-char opCaption[OPERATION_CAPTION_MAX_SIZE];
-char detailCaption[DETAIL_CAPTION_MAX_SIZE];
-char detailValue[DETAIL_VALUE_MAX_SIZE];
-
-format_function_t formatter_stack[MAX_FORMATTERS_PER_OPERATION];
-int8_t formatter_index;
+#include "stellar_jobs.h"
+
+APP_THREAD_LOCAL char detailCaption[DETAIL_CAPTION_MAX_SIZE];
+APP_THREAD_LOCAL char detailValue[DETAIL_VALUE_MAX_SIZE];
+APP_THREAD_LOCAL strbuf_t detailValueBuf;
+APP_THREAD_LOCAL uint8_t detailCaptionId;
+
+/* caption texts, stored once and referenced by id */
+static const char *const CAPTIONS[CAPTION_COUNT] = {
+    [CAPTION_NONE] = "",
+    [CAPTION_TX_SOURCE] = "Tx Source",
+    [CAPTION_SIGNING_KEY] = "Signing Key",
+    [CAPTION_TIME_BOUNDS_TO] = "Time Bounds To",
+    [CAPTION_TIME_BOUNDS_FROM] = "Time Bounds From",
+    [CAPTION_NETWORK] = "Network",
+    [CAPTION_FEE] = "Fee",
+    [CAPTION_MEMO_ID] = "Memo ID",
+    [CAPTION_MEMO_TEXT] = "Memo Text",
+    [CAPTION_MEMO_HASH] = "Memo Hash",
+    [CAPTION_MEMO_RETURN] = "Memo Return",
+    [CAPTION_MEMO] = "Memo",
+    [CAPTION_OP_SOURCE] = "Op Source",
+    [CAPTION_BUMP_SEQUENCE] = "Bump Sequence",
+    [CAPTION_DESTINATION] = "Destination",
+    [CAPTION_MERGE_ACCOUNT] = "Merge Account",
+    [CAPTION_DATA_VALUE] = "Data Value",
+    [CAPTION_SET_DATA] = "Set Data",
+    [CAPTION_REMOVE_DATA] = "Remove Data",
+    [CAPTION_ACCOUNT_ID] = "Account ID",
+    [CAPTION_ALLOW_TRUST] = "Allow Trust",
+    [CAPTION_REVOKE_TRUST] = "Revoke Trust",
+    [CAPTION_WEIGHT] = "Weight",
+    [CAPTION_SIGNER_KEY] = "Signer Key",
+    [CAPTION_ADD_SIGNER] = "Add Signer",
+    [CAPTION_REMOVE_SIGNER] = "Remove Signer",
+    [CAPTION_HOME_DOMAIN] = "Home Domain",
+    [CAPTION_HIGH_THRESHOLD] = "High Threshold",
+    [CAPTION_MEDIUM_THRESHOLD] = "Medium Threshold",
+    [CAPTION_LOW_THRESHOLD] = "Low Threshold",
+    [CAPTION_MASTER_WEIGHT] = "Master Weight",
+    [CAPTION_SET_FLAGS] = "Set Flags",
+    [CAPTION_CLEAR_FLAGS] = "Clear Flags",
+    [CAPTION_INFLATION_DEST] = "Inflation Dest",
+    [CAPTION_TRUST_LIMIT] = "Trust Limit",
+    [CAPTION_CHANGE_TRUST] = "Change Trust",
+    [CAPTION_REMOVE_TRUST] = "Remove Trust",
+    [CAPTION_SELL] = "Sell",
+    [CAPTION_PRICE] = "Price",
+    [CAPTION_BUY] = "Buy",
+    [CAPTION_REMOVE_OFFER] = "Remove Offer",
+    [CAPTION_CHANGE_OFFER] = "Change Offer",
+    [CAPTION_CREATE_OFFER] = "Create Offer",
+    [CAPTION_VIA] = "Via",
+    [CAPTION_RECEIVE] = "Receive",
+    [CAPTION_SEND_MAX] = "Send Max",
+    [CAPTION_SEND] = "Send",
+    [CAPTION_STARTING_BALANCE] = "Starting Balance",
+    [CAPTION_CREATE_ACCOUNT] = "Create Account",
+    [CAPTION_HASH] = "Hash",
+    [CAPTION_HASHES] = "Hashes",
+    [CAPTION_DIGEST] = "Digest",
+    [CAPTION_WARNING] = "WARNING",
+    [CAPTION_RUN_INFLATION] = "Run Inflation",
+};
+
+APP_THREAD_LOCAL format_function_t formatter_stack[MAX_FORMATTERS_PER_OPERATION];
+APP_THREAD_LOCAL int8_t formatter_index;
 
 static void push_to_formatter_stack(format_function_t formatter) {
     if (formatter_index + 1 >= MAX_FORMATTERS_PER_OPERATION) {
@@ -18,21 +78,50 @@ static void push_to_formatter_stack(format_function_t formatter) {
     formatter_stack[formatter_index + 1] = formatter;
 }
 
+static void format_signing_key(tx_context_t *txCtx, uint8_t i);
+
+static void format_signing_key_0(tx_context_t *txCtx) {
+    format_signing_key(txCtx, 0);
+}
+
+static void format_signing_key_1(tx_context_t *txCtx) {
+    format_signing_key(txCtx, 1);
+}
+
+static void format_signing_key_2(tx_context_t *txCtx) {
+    format_signing_key(txCtx, 2);
+}
+
+/* one screen per signing path, the formatters take no argument so each index has its own */
+static const format_function_t signing_key_formatters[MAX_SIGNING_PATHS] = {
+    &format_signing_key_0,
+    &format_signing_key_1,
+    &format_signing_key_2,
+};
+
+static void format_signing_key(tx_context_t *txCtx, uint8_t i) {
+    detailCaptionId = CAPTION_SIGNING_KEY;
+    print_bip32_path(txCtx->bip32[i], txCtx->bip32Len[i], &detailValueBuf);
+    push_to_formatter_stack(i + 1 < txCtx->pathCount
+                                ? (format_function_t) PIC(signing_key_formatters[i + 1])
+                                : NULL);
+}
+
 static void format_transaction_source(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Tx Source");
+    detailCaptionId = CAPTION_TX_SOURCE;
     print_public_key(txCtx->txDetails.sourceAccount, detailValue, 0, 0);
-    push_to_formatter_stack(NULL);
+    push_to_formatter_stack(txCtx->pathCount > 1 ? &format_signing_key_0 : NULL);
 }
 
 static void format_time_bounds_max_time(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Time Bounds To");
-    print_uint(txCtx->txDetails.timeBounds.maxTime, detailValue, DETAIL_VALUE_MAX_SIZE);
+    detailCaptionId = CAPTION_TIME_BOUNDS_TO;
+    strbuf_append_uint(&detailValueBuf, txCtx->txDetails.timeBounds.maxTime);
     push_to_formatter_stack(&format_transaction_source);
 }
 
 static void format_time_bounds_min_time(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Time Bounds From");
-    print_uint(txCtx->txDetails.timeBounds.minTime, detailValue, DETAIL_VALUE_MAX_SIZE);
+    detailCaptionId = CAPTION_TIME_BOUNDS_FROM;
+    strbuf_append_uint(&detailValueBuf, txCtx->txDetails.timeBounds.minTime);
     push_to_formatter_stack(&format_time_bounds_max_time);
 }
 
@@ -45,15 +134,15 @@ static void format_time_bounds(tx_context_t *txCtx) {
 }
 
 static void format_network(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Network");
-    strlcpy(detailValue, (char *) PIC(NETWORK_NAMES[txCtx->network]), DETAIL_VALUE_MAX_SIZE);
+    detailCaptionId = CAPTION_NETWORK;
+    strbuf_append(&detailValueBuf, (const char *) PIC(NETWORK_NAMES[txCtx->network]));
     push_to_formatter_stack(&format_time_bounds);
 }
 
 static void format_fee(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Fee");
+    detailCaptionId = CAPTION_FEE;
     Asset asset = {.type = ASSET_TYPE_NATIVE};
-    print_amount(txCtx->txDetails.fee, &asset, txCtx->network, detailValue, DETAIL_VALUE_MAX_SIZE);
+    strbuf_append_amount(&detailValueBuf, txCtx->txDetails.fee, &asset, txCtx->network);
     push_to_formatter_stack(&format_network);
 }
 
@@ -61,28 +150,28 @@ static void format_memo(tx_context_t *txCtx) {
     Memo *memo = &txCtx->txDetails.memo;
     switch (memo->type) {
         case MEMO_ID: {
-            strcpy(detailCaption, "Memo ID");
-            print_uint(memo->id, detailValue, DETAIL_VALUE_MAX_SIZE);
+            detailCaptionId = CAPTION_MEMO_ID;
+            strbuf_append_uint(&detailValueBuf, memo->id);
             break;
         }
         case MEMO_TEXT: {
-            strcpy(detailCaption, "Memo Text");
-            strlcpy(detailValue, memo->text, MEMO_TEXT_MAX_SIZE + 1);
+            detailCaptionId = CAPTION_MEMO_TEXT;
+            strbuf_append_n(&detailValueBuf, memo->text, strnlen(memo->text, MEMO_TEXT_MAX_SIZE));
             break;
         }
         case MEMO_HASH: {
-            strcpy(detailCaption, "Memo Hash");
+            detailCaptionId = CAPTION_MEMO_HASH;
             print_binary_summary(memo->hash, detailValue, HASH_SIZE);
             break;
         }
         case MEMO_RETURN: {
-            strcpy(detailCaption, "Memo Return");
+            detailCaptionId = CAPTION_MEMO_RETURN;
             print_binary_summary(memo->hash, detailValue, HASH_SIZE);
             break;
         }
         default: {
-            strcpy(detailCaption, "Memo");
-            strcpy(detailValue, "[none]");
+            detailCaptionId = CAPTION_MEMO;
+            strbuf_append(&detailValueBuf, "[none]");
         }
     }
     push_to_formatter_stack(&format_fee);
@@ -94,7 +183,7 @@ static void format_confirm_transaction_details(tx_context_t *txCtx) {
 
 static void format_operation_source(tx_context_t *txCtx) {
     if (txCtx->opDetails.sourceAccountPresent) {
-        strcpy(detailCaption, "Op Source");
+        detailCaptionId = CAPTION_OP_SOURCE;
         print_public_key(txCtx->opDetails.sourceAccount, detailValue, 0, 0);
         push_to_formatter_stack(&format_confirm_transaction_details);
     } else {
@@ -110,25 +199,25 @@ static void format_operation_source(tx_context_t *txCtx) {
 }
 
 static void format_bump_sequence(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Bump Sequence");
-    print_int(txCtx->opDetails.bumpSequenceOp.bumpTo, detailValue, DETAIL_VALUE_MAX_SIZE);
+    detailCaptionId = CAPTION_BUMP_SEQUENCE;
+    strbuf_append_int(&detailValueBuf, txCtx->opDetails.bumpSequenceOp.bumpTo);
     push_to_formatter_stack(&format_operation_source);
 }
 
 static void format_inflation(tx_context_t *txCtx) {
     (void) txCtx;
-    strcpy(opCaption, "Run Inflation");
+    detailCaptionId = CAPTION_RUN_INFLATION;
     push_to_formatter_stack(&format_operation_source);
 }
 
 static void format_account_merge_destination(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Destination");
+    detailCaptionId = CAPTION_DESTINATION;
     print_public_key(txCtx->opDetails.destination, detailValue, 0, 0);
     push_to_formatter_stack(&format_operation_source);
 }
 
 static void format_account_merge(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Merge Account");
+    detailCaptionId = CAPTION_MERGE_ACCOUNT;
     if (txCtx->opDetails.sourceAccountPresent) {
         print_public_key(txCtx->opDetails.sourceAccount, detailValue, 0, 0);
     } else {
@@ -138,21 +227,21 @@ static void format_account_merge(tx_context_t *txCtx) {
 }
 
 static void format_manage_data_value(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Data Value");
-    char tmp[89];
-    base64_encode(txCtx->opDetails.manageDataOp.dataValue,
-                  txCtx->opDetails.manageDataOp.dataValueSize,
-                  tmp);
-    print_summary(tmp, detailValue, 12, 12);
+    detailCaptionId = CAPTION_DATA_VALUE;
+    print_base64_summary(txCtx->opDetails.manageDataOp.dataValue,
+                         txCtx->opDetails.manageDataOp.dataValueSize,
+                         detailValue,
+                         12,
+                         12);
     push_to_formatter_stack(&format_operation_source);
 }
 
 static void format_manage_data(tx_context_t *txCtx) {
     if (txCtx->opDetails.manageDataOp.dataValueSize) {
-        strcpy(detailCaption, "Set Data");
+        detailCaptionId = CAPTION_SET_DATA;
         push_to_formatter_stack(&format_manage_data_value);
     } else {
-        strcpy(detailCaption, "Remove Data");
+        detailCaptionId = CAPTION_REMOVE_DATA;
         push_to_formatter_stack(&format_operation_source);
     }
     char tmp[65];
@@ -162,25 +251,25 @@ static void format_manage_data(tx_context_t *txCtx) {
 }
 
 static void format_allow_trust_trustor(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Account ID");
+    detailCaptionId = CAPTION_ACCOUNT_ID;
     print_public_key(txCtx->opDetails.allowTrustOp.trustor, detailValue, 0, 0);
     push_to_formatter_stack(&format_operation_source);
 }
 
 static void format_allow_trust(tx_context_t *txCtx) {
     if (txCtx->opDetails.allowTrustOp.authorize) {
-        strcpy(detailCaption, "Allow Trust");
+        detailCaptionId = CAPTION_ALLOW_TRUST;
     } else {
-        strcpy(detailCaption, "Revoke Trust");
+        detailCaptionId = CAPTION_REVOKE_TRUST;
     }
-    strlcpy(detailValue, txCtx->opDetails.allowTrustOp.assetCode, DETAIL_VALUE_MAX_SIZE);
+    strbuf_append(&detailValueBuf, txCtx->opDetails.allowTrustOp.assetCode);
     push_to_formatter_stack(&format_allow_trust_trustor);
 }
 
 static void format_set_option_signer_weight(tx_context_t *txCtx) {
     if (txCtx->opDetails.setOptionsOp.signer.weight) {
-        strcpy(detailCaption, "Weight");
-        print_uint(txCtx->opDetails.setOptionsOp.signer.weight, detailValue, DETAIL_VALUE_MAX_SIZE);
+        detailCaptionId = CAPTION_WEIGHT;
+        strbuf_append_uint(&detailValueBuf, txCtx->opDetails.setOptionsOp.signer.weight);
         push_to_formatter_stack(&format_operation_source);
     } else {
         format_operation_source(txCtx);
@@ -188,7 +277,7 @@ static void format_set_option_signer_weight(tx_context_t *txCtx) {
 }
 
 static void format_set_option_signer_detail(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Signer Key");
+    detailCaptionId = CAPTION_SIGNER_KEY;
     SignerKey *key = &txCtx->opDetails.setOptionsOp.signer.key;
 
     switch (key->type) {
@@ -197,16 +286,12 @@ static void format_set_option_signer_detail(tx_context_t *txCtx) {
             break;
         }
         case SIGNER_KEY_TYPE_HASH_X: {
-            char tmp[57];
-            encode_hash_x_key(key->data, tmp);
-            print_summary(tmp, detailValue, 12, 12);
+            print_strkey(key->data, STRKEY_VERSION_HASH_X, detailValue, 12, 12);
             break;
         }
 
         case SIGNER_KEY_TYPE_PRE_AUTH_TX: {
-            char tmp[57];
-            encode_pre_auth_key(key->data, tmp);
-            print_summary(tmp, detailValue, 12, 12);
+            print_strkey(key->data, STRKEY_VERSION_PRE_AUTH_TX, detailValue, 12, 12);
             break;
         }
     }
@@ -217,21 +302,21 @@ static void format_set_option_signer(tx_context_t *txCtx) {
     if (txCtx->opDetails.setOptionsOp.signerPresent) {
         signer_t *signer = &txCtx->opDetails.setOptionsOp.signer;
         if (signer->weight) {
-            strcpy(detailCaption, "Add Signer");
+            detailCaptionId = CAPTION_ADD_SIGNER;
         } else {
-            strcpy(detailCaption, "Remove Signer");
+            detailCaptionId = CAPTION_REMOVE_SIGNER;
         }
         switch (signer->key.type) {
             case SIGNER_KEY_TYPE_ED25519: {
-                strcpy(detailValue, "Type Public Key");
+                strbuf_append(&detailValueBuf, "Type Public Key");
                 break;
             }
             case SIGNER_KEY_TYPE_HASH_X: {
-                strcpy(detailValue, "Type Hash(x)");
+                strbuf_append(&detailValueBuf, "Type Hash(x)");
                 break;
             }
             case SIGNER_KEY_TYPE_PRE_AUTH_TX: {
-                strcpy(detailValue, "Type Pre-Auth");
+                strbuf_append(&detailValueBuf, "Type Pre-Auth");
                 break;
             }
         }
@@ -243,11 +328,10 @@ static void format_set_option_signer(tx_context_t *txCtx) {
 
 static void format_set_option_home_domain(tx_context_t *txCtx) {
     if (txCtx->opDetails.setOptionsOp.homeDomainSize) {
-        strcpy(detailCaption, "Home Domain");
-        memcpy(detailValue,
-               txCtx->opDetails.setOptionsOp.homeDomain,
-               txCtx->opDetails.setOptionsOp.homeDomainSize);
-        detailValue[txCtx->opDetails.setOptionsOp.homeDomainSize] = '\0';
+        detailCaptionId = CAPTION_HOME_DOMAIN;
+        strbuf_append_n(&detailValueBuf,
+                        (const char *) txCtx->opDetails.setOptionsOp.homeDomain,
+                        txCtx->opDetails.setOptionsOp.homeDomainSize);
         push_to_formatter_stack(&format_set_option_signer);
     } else {
         format_set_option_signer(txCtx);
@@ -256,8 +340,8 @@ static void format_set_option_home_domain(tx_context_t *txCtx) {
 
 static void format_set_option_high_threshold(tx_context_t *txCtx) {
     if (txCtx->opDetails.setOptionsOp.highThresholdPresent) {
-        strcpy(detailCaption, "High Threshold");
-        print_uint(txCtx->opDetails.setOptionsOp.highThreshold, detailValue, DETAIL_VALUE_MAX_SIZE);
+        detailCaptionId = CAPTION_HIGH_THRESHOLD;
+        strbuf_append_uint(&detailValueBuf, txCtx->opDetails.setOptionsOp.highThreshold);
         push_to_formatter_stack(&format_set_option_home_domain);
     } else {
         format_set_option_home_domain(txCtx);
@@ -266,10 +350,8 @@ static void format_set_option_high_threshold(tx_context_t *txCtx) {
 
 static void format_set_option_medium_threshold(tx_context_t *txCtx) {
     if (txCtx->opDetails.setOptionsOp.mediumThresholdPresent) {
-        strcpy(detailCaption, "Medium Threshold");
-        print_uint(txCtx->opDetails.setOptionsOp.mediumThreshold,
-                   detailValue,
-                   DETAIL_VALUE_MAX_SIZE);
+        detailCaptionId = CAPTION_MEDIUM_THRESHOLD;
+        strbuf_append_uint(&detailValueBuf, txCtx->opDetails.setOptionsOp.mediumThreshold);
         push_to_formatter_stack(&format_set_option_high_threshold);
     } else {
         format_set_option_high_threshold(txCtx);
@@ -278,8 +360,8 @@ static void format_set_option_medium_threshold(tx_context_t *txCtx) {
 
 static void format_set_option_low_threshold(tx_context_t *txCtx) {
     if (txCtx->opDetails.setOptionsOp.lowThresholdPresent) {
-        strcpy(detailCaption, "Low Threshold");
-        print_uint(txCtx->opDetails.setOptionsOp.lowThreshold, detailValue, DETAIL_VALUE_MAX_SIZE);
+        detailCaptionId = CAPTION_LOW_THRESHOLD;
+        strbuf_append_uint(&detailValueBuf, txCtx->opDetails.setOptionsOp.lowThreshold);
         push_to_formatter_stack(&format_set_option_medium_threshold);
     } else {
         format_set_option_medium_threshold(txCtx);
@@ -288,8 +370,8 @@ static void format_set_option_low_threshold(tx_context_t *txCtx) {
 
 static void format_set_option_master_weight(tx_context_t *txCtx) {
     if (txCtx->opDetails.setOptionsOp.masterWeightPresent) {
-        strcpy(detailCaption, "Master Weight");
-        print_uint(txCtx->opDetails.setOptionsOp.masterWeight, detailValue, DETAIL_VALUE_MAX_SIZE);
+        detailCaptionId = CAPTION_MASTER_WEIGHT;
+        strbuf_append_uint(&detailValueBuf, txCtx->opDetails.setOptionsOp.masterWeight);
         push_to_formatter_stack(&format_set_option_low_threshold);
     } else {
         format_set_option_low_threshold(txCtx);
@@ -298,8 +380,8 @@ static void format_set_option_master_weight(tx_context_t *txCtx) {
 
 static void format_set_option_set_flags(tx_context_t *txCtx) {
     if (txCtx->opDetails.setOptionsOp.setFlags) {
-        strcpy(detailCaption, "Set Flags");
-        print_flags(txCtx->opDetails.setOptionsOp.setFlags, detailValue, DETAIL_VALUE_MAX_SIZE);
+        detailCaptionId = CAPTION_SET_FLAGS;
+        print_flags(txCtx->opDetails.setOptionsOp.setFlags, &detailValueBuf);
         push_to_formatter_stack(&format_set_option_master_weight);
     } else {
         format_set_option_master_weight(txCtx);
@@ -308,8 +390,8 @@ static void format_set_option_set_flags(tx_context_t *txCtx) {
 
 static void format_set_option_clear_flags(tx_context_t *txCtx) {
     if (txCtx->opDetails.setOptionsOp.clearFlags) {
-        strcpy(detailCaption, "Clear Flags");
-        print_flags(txCtx->opDetails.setOptionsOp.clearFlags, detailValue, DETAIL_VALUE_MAX_SIZE);
+        detailCaptionId = CAPTION_CLEAR_FLAGS;
+        print_flags(txCtx->opDetails.setOptionsOp.clearFlags, &detailValueBuf);
         push_to_formatter_stack(&format_set_option_set_flags);
     } else {
         format_set_option_set_flags(txCtx);
@@ -318,7 +400,7 @@ static void format_set_option_clear_flags(tx_context_t *txCtx) {
 
 static void format_set_option_inflation_destination(tx_context_t *txCtx) {
     if (txCtx->opDetails.setOptionsOp.inflationDestinationPresent) {
-        strcpy(detailCaption, "Inflation Dest");
+        detailCaptionId = CAPTION_INFLATION_DEST;
         print_public_key(txCtx->opDetails.setOptionsOp.inflationDestination, detailValue, 0, 0);
         push_to_formatter_stack(&format_set_option_clear_flags);
     } else {
@@ -331,86 +413,74 @@ static void format_set_options(tx_context_t *txCtx) {
 }
 
 static void format_change_trust_limit(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Trust Limit");
+    detailCaptionId = CAPTION_TRUST_LIMIT;
     if (txCtx->opDetails.changeTrustOp.limit == INT64_MAX) {
-        strcpy(detailValue, "[maximum]");
+        strbuf_append(&detailValueBuf, "[maximum]");
     } else {
-        print_amount(txCtx->opDetails.changeTrustOp.limit,
-                     NULL,
-                     txCtx->network,
-                     detailValue,
-                     DETAIL_VALUE_MAX_SIZE);
+        strbuf_append_amount(&detailValueBuf,
+                             txCtx->opDetails.changeTrustOp.limit,
+                             NULL,
+                             txCtx->network);
     }
     push_to_formatter_stack(&format_operation_source);
 }
 
 static void format_change_trust(tx_context_t *txCtx) {
     if (txCtx->opDetails.changeTrustOp.limit) {
-        strcpy(detailCaption, "Change Trust");
+        detailCaptionId = CAPTION_CHANGE_TRUST;
         push_to_formatter_stack(&format_change_trust_limit);
     } else {
-        strcpy(detailCaption, "Remove Trust");
+        detailCaptionId = CAPTION_REMOVE_TRUST;
         push_to_formatter_stack(&format_operation_source);
     }
     uint8_t asset_type = txCtx->opDetails.changeTrustOp.line.type;
     if (asset_type != ASSET_TYPE_CREDIT_ALPHANUM4 && asset_type != ASSET_TYPE_CREDIT_ALPHANUM12) {
         return;
     }
-    print_asset_t(&txCtx->opDetails.changeTrustOp.line,
-                  txCtx->network,
-                  detailValue,
-                  DETAIL_VALUE_MAX_SIZE);
+    print_asset_t(&txCtx->opDetails.changeTrustOp.line, txCtx->network, &detailValueBuf);
 }
 
 static void format_manage_offer_sell(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Sell");
-    print_amount(txCtx->opDetails.manageSellOfferOp.amount,
-                 &txCtx->opDetails.manageSellOfferOp.selling,
-                 txCtx->network,
-                 detailValue,
-                 DETAIL_VALUE_MAX_SIZE);
+    detailCaptionId = CAPTION_SELL;
+    strbuf_append_amount(&detailValueBuf,
+                         txCtx->opDetails.manageSellOfferOp.amount,
+                         &txCtx->opDetails.manageSellOfferOp.selling,
+                         txCtx->network);
     push_to_formatter_stack(&format_operation_source);
 }
 
 static void format_manage_offer_price(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Price");
-    uint64_t price = ((uint64_t) txCtx->opDetails.manageSellOfferOp.price.n * 10000000) /
-                     txCtx->opDetails.manageSellOfferOp.price.d;
-    print_amount(price,
-                 &txCtx->opDetails.manageSellOfferOp.buying,
-                 txCtx->network,
-                 detailValue,
-                 DETAIL_VALUE_MAX_SIZE);
+    detailCaptionId = CAPTION_PRICE;
+    strbuf_append_price(&detailValueBuf,
+                        &txCtx->opDetails.manageSellOfferOp.price,
+                        &txCtx->opDetails.manageSellOfferOp.buying,
+                        txCtx->network,
+                        PRICE_SIGNIFICANT_DIGITS);
     push_to_formatter_stack(&format_manage_offer_sell);
 }
 
 static void format_manage_offer_buy(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Buy");
+    detailCaptionId = CAPTION_BUY;
     if (txCtx->opDetails.manageSellOfferOp.buying.type == ASSET_TYPE_NATIVE) {
-        print_native_asset_code(txCtx->network, detailValue, DETAIL_VALUE_MAX_SIZE);
+        print_native_asset_code(txCtx->network, &detailValueBuf);
     } else {
-        print_asset_t(&txCtx->opDetails.manageSellOfferOp.buying,
-                      txCtx->network,
-                      detailValue,
-                      DETAIL_VALUE_MAX_SIZE);
+        print_asset_t(&txCtx->opDetails.manageSellOfferOp.buying, txCtx->network, &detailValueBuf);
     }
     push_to_formatter_stack(&format_manage_offer_price);
 }
 
 static void format_manage_offer(tx_context_t *txCtx) {
     if (!txCtx->opDetails.manageSellOfferOp.amount) {
-        strcpy(detailCaption, "Remove Offer");
-        print_uint(txCtx->opDetails.manageSellOfferOp.offerID, detailValue, DETAIL_VALUE_MAX_SIZE);
+        detailCaptionId = CAPTION_REMOVE_OFFER;
+        strbuf_append_uint(&detailValueBuf, txCtx->opDetails.manageSellOfferOp.offerID);
         push_to_formatter_stack(&format_operation_source);
     } else {
         if (txCtx->opDetails.manageSellOfferOp.offerID) {
-            strcpy(detailCaption, "Change Offer");
-            print_uint(txCtx->opDetails.manageSellOfferOp.offerID,
-                       detailValue,
-                       DETAIL_VALUE_MAX_SIZE);
+            detailCaptionId = CAPTION_CHANGE_OFFER;
+            strbuf_append_uint(&detailValueBuf, txCtx->opDetails.manageSellOfferOp.offerID);
         } else {
-            strcpy(detailCaption, "Create Offer");
-            strcpy(detailValue, "Type Active");
+            detailCaptionId = CAPTION_CREATE_OFFER;
+            strbuf_append(&detailValueBuf, "Type Active");
         }
         push_to_formatter_stack(&format_manage_offer_buy);
     }
@@ -419,28 +489,31 @@ static void format_manage_offer(tx_context_t *txCtx) {
 static void format_manage_buy_offer_buy(tx_context_t *txCtx) {
     ManageBuyOfferOp *op = &txCtx->opDetails.manageBuyOfferOp;
 
-    strcpy(detailCaption, "Buy");
-    print_amount(op->buyAmount, &op->buying, txCtx->network, detailValue, DETAIL_VALUE_MAX_SIZE);
+    detailCaptionId = CAPTION_BUY;
+    strbuf_append_amount(&detailValueBuf, op->buyAmount, &op->buying, txCtx->network);
     push_to_formatter_stack(&format_operation_source);
 }
 
 static void format_manage_buy_offer_price(tx_context_t *txCtx) {
     ManageBuyOfferOp *op = &txCtx->opDetails.manageBuyOfferOp;
 
-    strcpy(detailCaption, "Price");
-    uint64_t price = ((uint64_t) op->price.n * 10000000) / op->price.d;
-    print_amount(price, &op->selling, txCtx->network, detailValue, DETAIL_VALUE_MAX_SIZE);
+    detailCaptionId = CAPTION_PRICE;
+    strbuf_append_price(&detailValueBuf,
+                        &op->price,
+                        &op->selling,
+                        txCtx->network,
+                        PRICE_SIGNIFICANT_DIGITS);
     push_to_formatter_stack(&format_manage_buy_offer_buy);
 }
 
 static void format_manage_buy_offer_sell(tx_context_t *txCtx) {
     ManageBuyOfferOp *op = &txCtx->opDetails.manageBuyOfferOp;
 
-    strcpy(detailCaption, "Sell");
+    detailCaptionId = CAPTION_SELL;
     if (op->selling.type == ASSET_TYPE_NATIVE) {
-        print_native_asset_code(txCtx->network, detailValue, DETAIL_VALUE_MAX_SIZE);
+        print_native_asset_code(txCtx->network, &detailValueBuf);
     } else {
-        print_asset_t(&op->selling, txCtx->network, detailValue, DETAIL_VALUE_MAX_SIZE);
+        print_asset_t(&op->selling, txCtx->network, &detailValueBuf);
     }
     push_to_formatter_stack(&format_manage_buy_offer_price);
 }
@@ -449,72 +522,71 @@ static void format_manage_buy_offer(tx_context_t *txCtx) {
     ManageBuyOfferOp *op = &txCtx->opDetails.manageBuyOfferOp;
 
     if (op->buyAmount == 0) {
-        strcpy(detailCaption, "Remove Offer");
-        print_uint(op->offerID, detailValue, DETAIL_VALUE_MAX_SIZE);
+        detailCaptionId = CAPTION_REMOVE_OFFER;
+        strbuf_append_uint(&detailValueBuf, op->offerID);
         push_to_formatter_stack(&format_operation_source);  // TODO
     } else {
         if (op->offerID) {
-            strcpy(detailCaption, "Change Offer");
-            print_uint(op->offerID, detailValue, DETAIL_VALUE_MAX_SIZE);
+            detailCaptionId = CAPTION_CHANGE_OFFER;
+            strbuf_append_uint(&detailValueBuf, op->offerID);
         } else {
-            strcpy(detailCaption, "Create Offer");
-            strcpy(detailValue, "Type Active");
+            detailCaptionId = CAPTION_CREATE_OFFER;
+            strbuf_append(&detailValueBuf, "Type Active");
         }
         push_to_formatter_stack(&format_manage_buy_offer_sell);
     }
 }
 
 static void format_create_passive_sell_offer_sell(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Sell");
-    print_amount(txCtx->opDetails.createPassiveSellOfferOp.amount,
-                 &txCtx->opDetails.createPassiveSellOfferOp.selling,
-                 txCtx->network,
-                 detailValue,
-                 DETAIL_VALUE_MAX_SIZE);
+    detailCaptionId = CAPTION_SELL;
+    strbuf_append_amount(&detailValueBuf,
+                         txCtx->opDetails.createPassiveSellOfferOp.amount,
+                         &txCtx->opDetails.createPassiveSellOfferOp.selling,
+                         txCtx->network);
     push_to_formatter_stack(&format_operation_source);
 }
 
 static void format_create_passive_sell_offer_price(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Price");
+    detailCaptionId = CAPTION_PRICE;
 
     CreatePassiveSellOfferOp *op = &txCtx->opDetails.createPassiveSellOfferOp;
-    uint64_t price = ((uint64_t) op->price.n * 10000000) / op->price.d;
-    print_amount(price, &op->buying, txCtx->network, detailValue, DETAIL_VALUE_MAX_SIZE);
+    strbuf_append_price(&detailValueBuf,
+                        &op->price,
+                        &op->buying,
+                        txCtx->network,
+                        PRICE_SIGNIFICANT_DIGITS);
     push_to_formatter_stack(&format_create_passive_sell_offer_sell);
 }
 
 static void format_create_passive_sell_offer_buy(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Buy");
+    detailCaptionId = CAPTION_BUY;
     if (txCtx->opDetails.createPassiveSellOfferOp.buying.type == ASSET_TYPE_NATIVE) {
-        print_native_asset_code(txCtx->network, detailValue, DETAIL_VALUE_MAX_SIZE);
+        print_native_asset_code(txCtx->network, &detailValueBuf);
     } else {
         print_asset_t(&txCtx->opDetails.createPassiveSellOfferOp.buying,
                       txCtx->network,
-                      detailValue,
-                      DETAIL_VALUE_MAX_SIZE);
+                      &detailValueBuf);
     }
     push_to_formatter_stack(&format_create_passive_sell_offer_price);
 }
 
 static void format_create_passive_sell_offer(tx_context_t *txCtx) {
     (void) txCtx;
-    strcpy(detailCaption, "Create Offer");
-    strcpy(detailValue, "Type Passive");
+    detailCaptionId = CAPTION_CREATE_OFFER;
+    strbuf_append(&detailValueBuf, "Type Passive");
     push_to_formatter_stack(&format_create_passive_sell_offer_buy);
 }
 
 static void format_path_via(tx_context_t *txCtx) {
     if (txCtx->opDetails.pathPaymentStrictReceiveOp.pathLen) {
-        strcpy(detailCaption, "Via");
+        detailCaptionId = CAPTION_VIA;
         uint8_t i;
         for (i = 0; i < txCtx->opDetails.pathPaymentStrictReceiveOp.pathLen; i++) {
-            char asset_name[12 + 1];
             Asset *asset = &txCtx->opDetails.pathPaymentStrictReceiveOp.path[i];
-            if (strlen(detailValue) != 0) {
-                strlcat(detailValue, ", ", DETAIL_VALUE_MAX_SIZE);
+            if (i != 0) {
+                strbuf_append(&detailValueBuf, ", ");
             }
-            print_asset_name(asset, txCtx->network, asset_name, sizeof(asset_name));
-            strlcat(detailValue, asset_name, DETAIL_VALUE_MAX_SIZE);
+            print_asset_name(asset, txCtx->network, &detailValueBuf);
         }
         push_to_formatter_stack(&format_operation_source);
     } else {
@@ -523,60 +595,56 @@ static void format_path_via(tx_context_t *txCtx) {
 }
 
 static void format_path_receive(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Receive");
-    print_amount(txCtx->opDetails.pathPaymentStrictReceiveOp.destAmount,
-                 &txCtx->opDetails.pathPaymentStrictReceiveOp.destAsset,
-                 txCtx->network,
-                 detailValue,
-                 DETAIL_VALUE_MAX_SIZE);
+    detailCaptionId = CAPTION_RECEIVE;
+    strbuf_append_amount(&detailValueBuf,
+                         txCtx->opDetails.pathPaymentStrictReceiveOp.destAmount,
+                         &txCtx->opDetails.pathPaymentStrictReceiveOp.destAsset,
+                         txCtx->network);
     push_to_formatter_stack(&format_path_via);
 }
 
 static void format_path_destination(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Destination");
+    detailCaptionId = CAPTION_DESTINATION;
     print_public_key(txCtx->opDetails.pathPaymentStrictReceiveOp.destination, detailValue, 0, 0);
     push_to_formatter_stack(&format_path_receive);
 }
 
 static void format_path_payment(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Send Max");
-    print_amount(txCtx->opDetails.pathPaymentStrictReceiveOp.sendMax,
-                 &txCtx->opDetails.pathPaymentStrictReceiveOp.sendAsset,
-                 txCtx->network,
-                 detailValue,
-                 DETAIL_VALUE_MAX_SIZE);
+    detailCaptionId = CAPTION_SEND_MAX;
+    strbuf_append_amount(&detailValueBuf,
+                         txCtx->opDetails.pathPaymentStrictReceiveOp.sendMax,
+                         &txCtx->opDetails.pathPaymentStrictReceiveOp.sendAsset,
+                         txCtx->network);
     push_to_formatter_stack(&format_path_destination);
 }
 
 static void format_payment_destination(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Destination");
+    detailCaptionId = CAPTION_DESTINATION;
     print_public_key(txCtx->opDetails.payment.destination, detailValue, 0, 0);
     push_to_formatter_stack(&format_operation_source);
 }
 
 static void format_payment(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Send");
-    print_amount(txCtx->opDetails.payment.amount,
-                 &txCtx->opDetails.payment.asset,
-                 txCtx->network,
-                 detailValue,
-                 DETAIL_VALUE_MAX_SIZE);
+    detailCaptionId = CAPTION_SEND;
+    strbuf_append_amount(&detailValueBuf,
+                         txCtx->opDetails.payment.amount,
+                         &txCtx->opDetails.payment.asset,
+                         txCtx->network);
     push_to_formatter_stack(&format_payment_destination);
 }
 
 static void format_create_account_amount(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Starting Balance");
+    detailCaptionId = CAPTION_STARTING_BALANCE;
     Asset asset = {.type = ASSET_TYPE_NATIVE};
-    print_amount(txCtx->opDetails.createAccount.startingBalance,
-                 &asset,
-                 txCtx->network,
-                 detailValue,
-                 DETAIL_VALUE_MAX_SIZE);
+    strbuf_append_amount(&detailValueBuf,
+                         txCtx->opDetails.createAccount.startingBalance,
+                         &asset,
+                         txCtx->network);
     push_to_formatter_stack(&format_operation_source);
 }
 
 static void format_create_account(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Create Account");
+    detailCaptionId = CAPTION_CREATE_ACCOUNT;
     print_public_key(txCtx->opDetails.createAccount.destination, detailValue, 0, 0);
     push_to_formatter_stack(&format_create_account_amount);
 }
@@ -597,13 +665,14 @@ static const format_function_t formatters[13] = {&format_create_account,
 
 void format_confirm_operation(tx_context_t *txCtx) {
     if (txCtx->opCount > 1) {
+        // the only composed caption, written in place of a caption id
         size_t len;
-        strcpy(opCaption, "Operation ");
-        len = strlen(opCaption);
-        print_uint(txCtx->opIdx, opCaption + len, OPERATION_CAPTION_MAX_SIZE - len);
-        strlcat(opCaption, " of ", sizeof(opCaption));
-        len = strlen(opCaption);
-        print_uint(txCtx->opCount, opCaption + len, OPERATION_CAPTION_MAX_SIZE - len);
+        strcpy(detailCaption, "Operation ");
+        len = strlen(detailCaption);
+        print_uint(txCtx->opIdx, detailCaption + len, DETAIL_CAPTION_MAX_SIZE - len);
+        strlcat(detailCaption, " of ", sizeof(detailCaption));
+        len = strlen(detailCaption);
+        print_uint(txCtx->opCount, detailCaption + len, DETAIL_CAPTION_MAX_SIZE - len);
         push_to_formatter_stack(((format_function_t) PIC(formatters[txCtx->opDetails.type])));
     } else {
         ((format_function_t) PIC(formatters[txCtx->opDetails.type]))(txCtx);
@@ -611,19 +680,199 @@ void format_confirm_operation(tx_context_t *txCtx) {
 }
 
 static void format_confirm_hash_detail(tx_context_t *txCtx) {
-    strcpy(detailCaption, "Hash");
+    detailCaptionId = CAPTION_HASH;
     print_binary_summary(txCtx->hash, detailValue, 32);
     push_to_formatter_stack(NULL);
 }
 
 void format_confirm_hash_warning(tx_context_t *txCtx) {
     (void) txCtx;
-    strcpy(detailCaption, "WARNING");
-    strcpy(detailValue, "No details available");
+    detailCaptionId = CAPTION_WARNING;
+    strbuf_append(&detailValueBuf, "No details available");
     push_to_formatter_stack(&format_confirm_hash_detail);
 }
 
-uint8_t current_data_index;
+static void format_confirm_hashes_digest(tx_context_t *txCtx) {
+    detailCaptionId = CAPTION_DIGEST;
+    // in full, a summary is too short to compare with the digest shown by the host
+    print_hex(txCtx->hash, HASH_SIZE, detailValue);
+    push_to_formatter_stack(NULL);
+}
+
+static void format_confirm_hashes_count(tx_context_t *txCtx) {
+    detailCaptionId = CAPTION_HASHES;
+    strbuf_append_uint(&detailValueBuf, txCtx->hashCount);
+    push_to_formatter_stack(&format_confirm_hashes_digest);
+}
+
+static void format_confirm_hashes_warning(tx_context_t *txCtx) {
+    (void) txCtx;
+    detailCaptionId = CAPTION_WARNING;
+    strbuf_append(&detailValueBuf, "No details available");
+    push_to_formatter_stack(&format_confirm_hashes_count);
+}
+
+static uint8_t get_tx_details_screen_count(const tx_context_t *txCtx) {
+    // memo, fee, network and tx source, plus both time bounds and each signing key if present
+    uint8_t count = txCtx->txDetails.hasTimeBounds ? 6 : 4;
+    return txCtx->pathCount > 1 ? count + txCtx->pathCount : count;
+}
+
+static uint8_t get_set_options_screen_count(const SetOptionsOp *op) {
+    uint8_t count = 0;
+    count += op->inflationDestinationPresent ? 1 : 0;
+    count += op->clearFlags ? 1 : 0;
+    count += op->setFlags ? 1 : 0;
+    count += op->masterWeightPresent ? 1 : 0;
+    count += op->lowThresholdPresent ? 1 : 0;
+    count += op->mediumThresholdPresent ? 1 : 0;
+    count += op->highThresholdPresent ? 1 : 0;
+    count += op->homeDomainSize ? 1 : 0;
+    if (op->signerPresent) {
+        // signer type and signer key, plus the weight when adding
+        count += op->signer.weight ? 3 : 2;
+    }
+    return count;
+}
+
+uint8_t get_operation_screen_count(const tx_context_t *txCtx) {
+    const Operation *op = &txCtx->opDetails;
+    uint8_t count = 0;
+
+    if (txCtx->opCount > 1) {
+        count++;  // "Operation i of n"
+    }
+
+    switch (op->type) {
+        case XDR_OPERATION_TYPE_CREATE_ACCOUNT:
+        case XDR_OPERATION_TYPE_PAYMENT:
+        case XDR_OPERATION_TYPE_ALLOW_TRUST:
+        case XDR_OPERATION_TYPE_ACCOUNT_MERGE:
+            count += 2;
+            break;
+        case XDR_OPERATION_TYPE_PATH_PAYMENT_STRICT_RECEIVE:
+            count += op->pathPaymentStrictReceiveOp.pathLen ? 4 : 3;
+            break;
+        case XDR_OPERATION_TYPE_MANAGE_SELL_OFFER:
+            count += op->manageSellOfferOp.amount ? 4 : 1;
+            break;
+        case XDR_OPERATION_TYPE_CREATE_PASSIVE_SELL_OFFER:
+            count += 4;
+            break;
+        case XDR_OPERATION_TYPE_SET_OPTIONS:
+            count += get_set_options_screen_count(&op->setOptionsOp);
+            break;
+        case XDR_OPERATION_TYPE_CHANGE_TRUST:
+            count += op->changeTrustOp.limit ? 2 : 1;
+            break;
+        case XDR_OPERATION_TYPE_INFLATION:
+        case XDR_OPERATION_TYPE_BUMP_SEQUENCE:
+            count += 1;
+            break;
+        case XDR_OPERATION_TYPE_MANAGE_DATA:
+            count += op->manageDataOp.dataValueSize ? 2 : 1;
+            break;
+        case XDR_OPERATION_TYPE_MANAGE_BUY_OFFER:
+            count += op->manageBuyOfferOp.buyAmount ? 4 : 1;
+            break;
+        default:
+            break;
+    }
+
+    // format_operation_source shows the transaction details after an operation source, and after
+    // the last operation
+    if (op->sourceAccountPresent) {
+        count += 1 + get_tx_details_screen_count(txCtx);
+    } else if (txCtx->opIdx == txCtx->opCount) {
+        count += get_tx_details_screen_count(txCtx);
+    }
+    return count;
+}
+
+bool get_transaction_screen_count(tx_context_t *txCtx, uint16_t *count) {
+    // walk all operations without formatting them, then restore the parser position
+    uint16_t offset = txCtx->offset;
+    uint8_t opIdx = txCtx->opIdx;
+    Operation opDetails = txCtx->opDetails;
+    bool ok = true;
+
+    *count = 0;
+    txCtx->offset = 0;
+    do {
+        if (!parse_tx_xdr(txCtx->raw, txCtx->rawLength, txCtx)) {
+            ok = false;
+            break;
+        }
+        *count += get_operation_screen_count(txCtx);
+    } while (txCtx->opIdx < txCtx->opCount);
+
+    txCtx->offset = offset;
+    txCtx->opIdx = opIdx;
+    txCtx->opDetails = opDetails;
+    return ok;
+}
+
+#ifdef HAVE_KEY_CACHES
+/* keys of the parsed operation shown in full, in the order of their screens */
+static uint8_t get_displayed_keys(const tx_context_t *txCtx, const uint8_t **keys) {
+    const Operation *op = &txCtx->opDetails;
+    uint8_t count = 0;
+
+    switch (op->type) {
+        case XDR_OPERATION_TYPE_CREATE_ACCOUNT:
+            keys[count++] = op->createAccount.destination;
+            break;
+        case XDR_OPERATION_TYPE_PAYMENT:
+            keys[count++] = op->payment.destination;
+            break;
+        case XDR_OPERATION_TYPE_PATH_PAYMENT_STRICT_RECEIVE:
+            keys[count++] = op->pathPaymentStrictReceiveOp.destination;
+            break;
+        case XDR_OPERATION_TYPE_SET_OPTIONS:
+            if (op->setOptionsOp.inflationDestinationPresent) {
+                keys[count++] = op->setOptionsOp.inflationDestination;
+            }
+            if (op->setOptionsOp.signerPresent &&
+                op->setOptionsOp.signer.key.type == SIGNER_KEY_TYPE_ED25519) {
+                keys[count++] = op->setOptionsOp.signer.key.data;
+            }
+            break;
+        case XDR_OPERATION_TYPE_ALLOW_TRUST:
+            keys[count++] = op->allowTrustOp.trustor;
+            break;
+        case XDR_OPERATION_TYPE_ACCOUNT_MERGE:
+            keys[count++] =
+                op->sourceAccountPresent ? op->sourceAccount : txCtx->txDetails.sourceAccount;
+            keys[count++] = op->destination;
+            break;
+        default:
+            break;
+    }
+    if (op->sourceAccountPresent) {
+        keys[count++] = op->sourceAccount;
+    }
+    if (op->sourceAccountPresent || txCtx->opIdx == txCtx->opCount) {
+        keys[count++] = txCtx->txDetails.sourceAccount;
+    }
+    return count;
+}
+
+/* background job: encode the addresses of the upcoming screens, one per slice */
+static bool prefetch_keys_job(uint8_t step) {
+    const uint8_t *keys[6];
+    uint8_t count = get_displayed_keys(&ctx.req.tx, keys);
+
+    if (count > STRKEY_CACHE_SIZE) {
+        count = STRKEY_CACHE_SIZE;
+    }
+    if (step < count) {
+        strkey_cache_warm(keys[step], STRKEY_VERSION_ACCOUNT_ID);
+    }
+    return step + 1 >= count;
+}
+#endif
+
+APP_THREAD_LOCAL uint8_t current_data_index;
 
 format_function_t get_formatter(tx_context_t *txCtx, bool forward) {
     switch (ctx.state) {
@@ -643,6 +892,9 @@ format_function_t get_formatter(tx_context_t *txCtx, bool forward) {
                     return NULL;
                 }
             }
+#ifdef HAVE_KEY_CACHES
+            jobs_schedule(&prefetch_keys_job);
+#endif
             return &format_confirm_operation;
         }
         case STATE_APPROVE_TX_HASH: {
@@ -651,6 +903,12 @@ format_function_t get_formatter(tx_context_t *txCtx, bool forward) {
             }
             return &format_confirm_hash_warning;
         }
+        case STATE_APPROVE_TX_HASHES: {
+            if (!forward) {
+                return NULL;
+            }
+            return &format_confirm_hashes_warning;
+        }
         default:
             THROW(0x6123);
     }
@@ -684,13 +942,26 @@ void set_state_data(bool forward) {
 
     // Apply last formatter to fill the screen's buffer
     if (formatter_stack[formatter_index]) {
+        detailCaptionId = CAPTION_NONE;
         MEMCLEAR(detailCaption);
         MEMCLEAR(detailValue);
-        MEMCLEAR(opCaption);
+        // values are appended, only the fixed width StrKey and hex printers write in place
+        strbuf_init(&detailValueBuf, detailValue, DETAIL_VALUE_MAX_SIZE);
         formatter_stack[formatter_index](&ctx.req.tx);
 
-        if (opCaption[0] != '\0') {
-            strlcpy(detailCaption, opCaption, sizeof(detailCaption));
+        if (detailValueBuf.truncated) {
+            // show that the value goes on
+            memcpy(detailValue + DETAIL_VALUE_MAX_SIZE - 4, "...", 4);
+        }
+
+        if (detailCaptionId != CAPTION_NONE) {
+            // the caption text is only resolved for the screen being drawn
+            strlcpy(detailCaption,
+                    (const char *) PIC(CAPTIONS[detailCaptionId]),
+                    sizeof(detailCaption));
+        }
+        if (detailValue[0] == '\0') {
+            // operation headers have a caption only
             detailValue[0] = ' ';
         }
     }
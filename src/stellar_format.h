@@ -18,6 +18,7 @@
 #define _STELLAR_FORMAT_H_
 
 #include "stellar_types.h"
+#include "stellar_api.h"
 
 /*
  * the formatter prints the details and defines the order of the details
@@ -29,15 +30,88 @@ typedef void (*format_function_t)(tx_context_t *txCtx);
 #define MAX_FORMATTERS_PER_OPERATION 16
 
 /* the current formatter */
-extern format_function_t formatter_stack[MAX_FORMATTERS_PER_OPERATION];
-extern int8_t formatter_index;
-extern uint8_t current_data_index;
+extern APP_THREAD_LOCAL format_function_t formatter_stack[MAX_FORMATTERS_PER_OPERATION];
+extern APP_THREAD_LOCAL int8_t formatter_index;
+extern APP_THREAD_LOCAL uint8_t current_data_index;
+
+/* captions of the detail screens, resolved to text when the screen is drawn */
+typedef enum {
+    CAPTION_NONE = 0,
+    CAPTION_TX_SOURCE,
+    CAPTION_SIGNING_KEY,
+    CAPTION_TIME_BOUNDS_TO,
+    CAPTION_TIME_BOUNDS_FROM,
+    CAPTION_NETWORK,
+    CAPTION_FEE,
+    CAPTION_MEMO_ID,
+    CAPTION_MEMO_TEXT,
+    CAPTION_MEMO_HASH,
+    CAPTION_MEMO_RETURN,
+    CAPTION_MEMO,
+    CAPTION_OP_SOURCE,
+    CAPTION_BUMP_SEQUENCE,
+    CAPTION_DESTINATION,
+    CAPTION_MERGE_ACCOUNT,
+    CAPTION_DATA_VALUE,
+    CAPTION_SET_DATA,
+    CAPTION_REMOVE_DATA,
+    CAPTION_ACCOUNT_ID,
+    CAPTION_ALLOW_TRUST,
+    CAPTION_REVOKE_TRUST,
+    CAPTION_WEIGHT,
+    CAPTION_SIGNER_KEY,
+    CAPTION_ADD_SIGNER,
+    CAPTION_REMOVE_SIGNER,
+    CAPTION_HOME_DOMAIN,
+    CAPTION_HIGH_THRESHOLD,
+    CAPTION_MEDIUM_THRESHOLD,
+    CAPTION_LOW_THRESHOLD,
+    CAPTION_MASTER_WEIGHT,
+    CAPTION_SET_FLAGS,
+    CAPTION_CLEAR_FLAGS,
+    CAPTION_INFLATION_DEST,
+    CAPTION_TRUST_LIMIT,
+    CAPTION_CHANGE_TRUST,
+    CAPTION_REMOVE_TRUST,
+    CAPTION_SELL,
+    CAPTION_PRICE,
+    CAPTION_BUY,
+    CAPTION_REMOVE_OFFER,
+    CAPTION_CHANGE_OFFER,
+    CAPTION_CREATE_OFFER,
+    CAPTION_VIA,
+    CAPTION_RECEIVE,
+    CAPTION_SEND_MAX,
+    CAPTION_SEND,
+    CAPTION_STARTING_BALANCE,
+    CAPTION_CREATE_ACCOUNT,
+    CAPTION_HASH,
+    CAPTION_HASHES,
+    CAPTION_DIGEST,
+    CAPTION_WARNING,
+    CAPTION_RUN_INFLATION,
+    CAPTION_COUNT,
+} caption_id_t;
 
 /* the current details printed by the formatter */
-extern char opCaption[OPERATION_CAPTION_MAX_SIZE];
-extern char detailCaption[DETAIL_CAPTION_MAX_SIZE];
-extern char detailValue[DETAIL_VALUE_MAX_SIZE];
+extern APP_THREAD_LOCAL char detailCaption[DETAIL_CAPTION_MAX_SIZE];
+extern APP_THREAD_LOCAL char detailValue[DETAIL_VALUE_MAX_SIZE];
+/* appends to detailValue, truncation is marked with an ellipsis */
+extern APP_THREAD_LOCAL strbuf_t detailValueBuf;
+extern APP_THREAD_LOCAL uint8_t detailCaptionId;
 
 void set_state_data(bool forward);
 
+/* number of screens shown for the operation currently parsed in txCtx->opDetails */
+uint8_t get_operation_screen_count(const tx_context_t *txCtx);
+
+/* number of screens of the whole transaction review, computed without formatting */
+bool get_transaction_screen_count(tx_context_t *txCtx, uint16_t *count);
+
+/* hash signing shows a warning and the hash */
+#define TX_HASH_SCREEN_COUNT 2
+
+/* batch hash signing shows a warning, the number of hashes and their digest */
+#define TX_HASHES_SCREEN_COUNT 3
+
 #endif
@@ -0,0 +1,62 @@
+/*******************************************************************************
+ *   Ledger Stellar App
+ *   (c) 2017-2018 Ledger
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ ********************************************************************************/
+#include <string.h>
+
+#include "stellar_jobs.h"
+#include "stellar_types.h"
+
+typedef struct {
+    job_function_t run;
+    uint8_t step;
+} job_t;
+
+static APP_THREAD_LOCAL job_t jobs[MAX_JOBS];
+static APP_THREAD_LOCAL uint8_t jobCount;
+
+bool jobs_schedule(job_function_t job) {
+    for (uint8_t i = 0; i < jobCount; i++) {
+        if (jobs[i].run == job) {
+            jobs[i].step = 0;
+            return true;
+        }
+    }
+    if (jobCount == MAX_JOBS) {
+        return false;
+    }
+    jobs[jobCount].run = job;
+    jobs[jobCount].step = 0;
+    jobCount++;
+    return true;
+}
+
+bool jobs_run_slice(void) {
+    if (jobCount == 0) {
+        return false;
+    }
+
+    job_t *job = &jobs[0];
+    if (job->run(job->step++)) {
+        jobCount--;
+        memmove(&jobs[0], &jobs[1], jobCount * sizeof(job_t));
+    }
+    return true;
+}
+
+void jobs_clear(void) {
+    MEMCLEAR(jobs);
+    jobCount = 0;
+}
@@ -0,0 +1,41 @@
+/*******************************************************************************
+ *   Ledger Stellar App
+ *   (c) 2017-2018 Ledger
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ ********************************************************************************/
+#ifndef _STELLAR_JOBS_H_
+#define _STELLAR_JOBS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Background jobs run cooperatively on ticker events, while the user reads a screen.
+ * A job performs one bounded slice of work per call, step being the number of slices already run,
+ * and returns true once it is done.
+ */
+typedef bool (*job_function_t)(uint8_t step);
+
+#define MAX_JOBS 4
+
+/** queue a job, or restart it from its first step if already queued */
+bool jobs_schedule(job_function_t job);
+
+/** run one slice of the first queued job, returns false if there was nothing to run */
+bool jobs_run_slice(void);
+
+/** drop all queued jobs */
+void jobs_clear(void);
+
+#endif
@@ -15,6 +15,327 @@
  *  limitations under the License.
  ********************************************************************************/
 
+#include <stddef.h>
+#include <string.h>
+#ifdef TEST
+#include <time.h>
+#endif
+
+#include "os.h"
+#include "cx.h"
+
+#include "stellar_api.h"
 #include "stellar_types.h"
+#include "stellar_vars.h"
+
+#ifdef TEST
+stellar_nv_store_t N_state_pic;
+nv_stats_t nv_stats;
+#else
+stellar_nv_store_t const N_state_pic;
+#endif
+
+nv_snapshot_t nv_shadow;
+
+/*
+ * last complete commit, snapshot slot the journal follows, journal records in use, bytes of the
+ * shadow changed since the commit
+ */
+static uint32_t nvVersion;
+static uint8_t nvSnapshot;
+static uint8_t nvJournalUsed;
+static uint8_t nvDirty[(sizeof(stellar_nv_state_t) + 7) / 8];
+
+static void nv_flash_write(volatile void *dst, const void *src, size_t length) {
+#ifdef TEST
+    size_t start = (const uint8_t *) dst - (const uint8_t *) &N_state_pic;
+    nv_stats.writes++;
+    nv_stats.bytes += length;
+    nv_stats.pages += (start + length - 1) / NVM_PAGE_SIZE - start / NVM_PAGE_SIZE + 1;
+#endif
+    nvm_write((void *) dst, (void *) src, length);
+}
+
+static uint16_t nv_record_crc(const nv_record_t *record) {
+    return crc16((const uint8_t *) record, offsetof(nv_record_t, crc));
+}
+
+static bool nv_record_valid(const nv_record_t *record) {
+    return record->length != 0 && record->length <= NV_RECORD_DATA_SIZE &&
+           record->offset + record->length <= sizeof(stellar_nv_state_t) &&
+           record->crc == nv_record_crc(record);
+}
+
+static void nv_record_read(uint8_t i, nv_record_t *record) {
+    memcpy(record, (const void *) &N_stellar_pstore.journal[i], sizeof(nv_record_t));
+}
+
+static uint16_t nv_snapshot_crc(const nv_snapshot_t *snapshot) {
+    return crc16((const uint8_t *) snapshot, offsetof(nv_snapshot_t, crc));
+}
+
+static bool nv_snapshot_valid(uint8_t i) {
+    const nv_snapshot_t *snapshot = (const nv_snapshot_t *) &N_stellar_pstore.snapshots[i];
+    return snapshot->crc == nv_snapshot_crc(snapshot);
+}
+
+/* the newest slot that verifies, else an empty state: erased flash reads as 0xff */
+static void nv_snapshot_load(void) {
+    bool valid0 = nv_snapshot_valid(0);
+    bool valid1 = nv_snapshot_valid(1);
+
+    if (!valid0 && !valid1) {
+        // the first snapshot goes to slot 0
+        MEMCLEAR(nv_shadow);
+        nvSnapshot = 1;
+        return;
+    }
+    nvSnapshot = valid1 && (!valid0 || N_stellar_pstore.snapshots[1].version >
+                                           N_stellar_pstore.snapshots[0].version);
+    memcpy(&nv_shadow, (const void *) &N_stellar_pstore.snapshots[nvSnapshot], sizeof(nv_shadow));
+}
+
+void nv_load(void) {
+    nv_record_t record;
+    uint8_t start = 0;  // first record of the commit being read
+
+    nv_snapshot_load();
+    nvVersion = nv_shadow.version;
+    // replay the commits that follow the snapshot, up to the first one that is torn or stale
+    for (uint8_t i = 0; i < NV_JOURNAL_SIZE; i++) {
+        nv_record_read(i, &record);
+        if (!nv_record_valid(&record) || record.version != nvVersion + 1) {
+            break;
+        }
+        if (record.flags & NV_RECORD_LAST) {
+            for (uint8_t j = start; j <= i; j++) {
+                nv_record_read(j, &record);
+                memcpy((uint8_t *) &nv_shadow.state + record.offset, record.data, record.length);
+            }
+            nvVersion++;
+            start = i + 1;
+        }
+    }
+    // the records of a torn commit are overwritten by the next one
+    nvJournalUsed = start;
+    MEMCLEAR(nvDirty);
+}
+
+void nv_write(void *field, const void *value, size_t length) {
+    uint8_t *dst = field;
+    const uint8_t *src = value;
+    size_t offset = dst - (uint8_t *) &nv_shadow.state;
+
+    if (dst < (uint8_t *) &nv_shadow.state || offset + length > sizeof(stellar_nv_state_t)) {
+        THROW(EXCEPTION_OVERFLOW);
+    }
+    for (size_t i = 0; i < length; i++, offset++) {
+        if (dst[i] != src[i]) {
+            dst[i] = src[i];
+            nvDirty[offset / 8] |= 1 << (offset % 8);
+        }
+    }
+}
+
+/* cover the changed bytes with records, returns max + 1 if more are needed */
+static uint8_t nv_build_records(nv_record_t *records, uint8_t max) {
+    uint8_t count = 0;
+
+    for (size_t offset = 0; offset < sizeof(stellar_nv_state_t); offset++) {
+        if ((nvDirty[offset / 8] & (1 << (offset % 8))) == 0) {
+            continue;
+        }
+        if (count == max) {
+            return max + 1;
+        }
+        size_t length = sizeof(stellar_nv_state_t) - offset;
+        if (length > NV_RECORD_DATA_SIZE) {
+            length = NV_RECORD_DATA_SIZE;
+        }
+        nv_record_t *record = &records[count++];
+        memset(record, 0, sizeof(nv_record_t));
+        record->offset = offset;
+        record->length = length;
+        memcpy(record->data, (const uint8_t *) &nv_shadow.state + offset, length);
+        offset += length - 1;
+    }
+    return count;
+}
+
+void nv_commit(void) {
+    nv_record_t records[NV_COMMIT_RECORDS];
+#ifdef TEST
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+#endif
+
+    uint8_t count = nv_build_records(records, NV_COMMIT_RECORDS);
+    if (count == 0) {
+        return;
+    }
+    nvVersion++;
+    if (count > NV_COMMIT_RECORDS || nvJournalUsed + count > NV_JOURNAL_SIZE) {
+        // a new snapshot in the other slot, the journal records are older than it and start over
+        nv_shadow.version = nvVersion;
+        nv_shadow.crc = nv_snapshot_crc(&nv_shadow);
+        nvSnapshot ^= 1;
+        nv_flash_write(&N_stellar_pstore.snapshots[nvSnapshot], &nv_shadow, sizeof(nv_shadow));
+        nvJournalUsed = 0;
+#ifdef TEST
+        nv_stats.snapshots++;
+#endif
+    } else {
+        // one write appending the records of the commit
+        for (uint8_t i = 0; i < count; i++) {
+            records[i].version = nvVersion;
+            records[i].flags = (i + 1 == count) ? NV_RECORD_LAST : 0;
+            records[i].crc = nv_record_crc(&records[i]);
+        }
+        nv_flash_write(&N_stellar_pstore.journal[nvJournalUsed],
+                       records,
+                       count * sizeof(nv_record_t));
+        nvJournalUsed += count;
+    }
+    MEMCLEAR(nvDirty);
+
+#ifdef TEST
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    nv_stats.commits++;
+    nv_stats.commitNs +=
+        (uint64_t) (end.tv_sec - start.tv_sec) * 1000000000u + (end.tv_nsec - start.tv_nsec);
+#endif
+}
+
+#ifdef HAVE_KEY_CACHES
+static void nv_pubkey_entry_tag(const uint8_t *tagKey,
+                                const nv_pubkey_entry_t *entry,
+                                uint8_t *tag) {
+    uint8_t mac[32];
+    cx_hmac_sha256(tagKey,
+                   32,
+                   (const uint8_t *) entry,
+                   offsetof(nv_pubkey_entry_t, tag),
+                   mac,
+                   sizeof(mac));
+    memcpy(tag, mac, NV_PUBKEY_TAG_SIZE);
+}
+
+/* false if the entry is empty or was not tagged with tagKey, e.g. under another seed */
+static bool nv_pubkey_entry_valid(const uint8_t *tagKey, const nv_pubkey_entry_t *entry) {
+    uint8_t tag[NV_PUBKEY_TAG_SIZE];
+    uint8_t diff = 0;
+
+    if (entry->bip32Len == 0 || entry->bip32Len > MAX_BIP32_LEN) {
+        return false;
+    }
+    nv_pubkey_entry_tag(tagKey, entry, tag);
+    for (uint8_t i = 0; i < NV_PUBKEY_TAG_SIZE; i++) {
+        diff |= tag[i] ^ entry->tag[i];
+    }
+    return diff == 0;
+}
+
+static bool nv_pubkey_entry_matches(const nv_pubkey_entry_t *entry,
+                                    const uint32_t *bip32,
+                                    uint8_t bip32Len) {
+    return entry->bip32Len == bip32Len &&
+           memcmp(entry->bip32, bip32, bip32Len * sizeof(uint32_t)) == 0;
+}
+
+static void nv_pubkey_entry_read(uint8_t i, nv_pubkey_entry_t *entry) {
+    memcpy(entry, &N_stellar_pstate.pubkeyCache[i], sizeof(nv_pubkey_entry_t));
+}
+
+/* lastUse of the most recently used entry, the counter persists with the entries */
+static uint32_t nv_pubkey_cache_last_use(void) {
+    uint32_t lastUse = 0;
+
+    for (uint8_t i = 0; i < NV_PUBKEY_CACHE_SIZE; i++) {
+        if (N_stellar_pstate.pubkeyCache[i].lastUse > lastUse) {
+            lastUse = N_stellar_pstate.pubkeyCache[i].lastUse;
+        }
+    }
+    return lastUse;
+}
+
+bool nv_pubkey_cache_lookup(const uint8_t *tagKey,
+                            const uint32_t *bip32,
+                            uint8_t bip32Len,
+                            uint8_t *publicKey,
+                            bool markUsed) {
+    nv_pubkey_entry_t entry;
+
+    for (uint8_t i = 0; i < NV_PUBKEY_CACHE_SIZE; i++) {
+        nv_pubkey_entry_read(i, &entry);
+        if (nv_pubkey_entry_matches(&entry, bip32, bip32Len) &&
+            nv_pubkey_entry_valid(tagKey, &entry)) {
+            memcpy(publicKey, entry.publicKey, 32);
+            uint32_t lastUse = nv_pubkey_cache_last_use();
+            if (markUsed && entry.lastUse != lastUse) {
+                // a single record, and none at all while the same account is used
+                lastUse++;
+                nv_write(&N_stellar_pstate.pubkeyCache[i].lastUse, &lastUse, sizeof(lastUse));
+                nv_commit();
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void nv_pubkey_cache_store(const uint8_t *tagKey,
+                           const uint32_t *bip32,
+                           uint8_t bip32Len,
+                           const uint8_t *publicKey) {
+    nv_pubkey_entry_t entry;
+    uint8_t slot = NV_PUBKEY_CACHE_SIZE;
+
+    if (bip32Len == 0 || bip32Len > MAX_BIP32_LEN) {
+        return;
+    }
+    // the slot of the same path, else the first one that is empty or invalid
+    for (uint8_t i = 0; i < NV_PUBKEY_CACHE_SIZE; i++) {
+        nv_pubkey_entry_read(i, &entry);
+        if (!nv_pubkey_entry_valid(tagKey, &entry)) {
+            if (slot == NV_PUBKEY_CACHE_SIZE) {
+                slot = i;
+            }
+        } else if (nv_pubkey_entry_matches(&entry, bip32, bip32Len)) {
+            if (memcmp(entry.publicKey, publicKey, 32) == 0) {
+                return;
+            }
+            slot = i;
+            break;
+        }
+    }
+    if (slot == NV_PUBKEY_CACHE_SIZE) {
+        // full: evict the least recently used entry
+        slot = 0;
+        for (uint8_t i = 1; i < NV_PUBKEY_CACHE_SIZE; i++) {
+            if (N_stellar_pstate.pubkeyCache[i].lastUse <
+                N_stellar_pstate.pubkeyCache[slot].lastUse) {
+                slot = i;
+            }
+        }
+    }
+
+    memset(&entry, 0, sizeof(entry));
+    entry.bip32Len = bip32Len;
+    memcpy(entry.bip32, bip32, bip32Len * sizeof(uint32_t));
+    memcpy(entry.publicKey, publicKey, 32);
+    nv_pubkey_entry_tag(tagKey, &entry, entry.tag);
+    entry.lastUse = nv_pubkey_cache_last_use() + 1;
+    nv_write(&N_stellar_pstate.pubkeyCache[slot], &entry, sizeof(entry));
+    nv_commit();
+}
+
+void nv_pubkey_cache_clear(void) {
+    nv_pubkey_entry_t entry;
 
-stellar_nv_state_t const N_state_pic;
+    memset(&entry, 0, sizeof(entry));
+    for (uint8_t i = 0; i < NV_PUBKEY_CACHE_SIZE; i++) {
+        nv_write(&N_stellar_pstate.pubkeyCache[i], &entry, sizeof(entry));
+    }
+    nv_commit();
+}
+#endif
@@ -30,7 +30,7 @@ static const uint8_t NETWORK_ID_PUBLIC_HASH[32] = {
 static const uint8_t NETWORK_ID_TEST_HASH[32] = {
     0xce, 0xe0, 0x30, 0x2d, 0x59, 0x84, 0x4d, 0x32, 0xbd, 0xca, 0x91, 0x5c, 0x82, 0x03, 0xdd, 0x44,
     0xb3, 0x3f, 0xbb, 0x7e, 0xdc, 0x19, 0x05, 0x1e, 0xa3, 0x7a, 0xbe, 0xdf, 0x28, 0xec, 0xd4, 0x72};
-uint8_t network_id;
+APP_THREAD_LOCAL uint8_t network_id;
 
 static bool buffer_can_read(const buffer_t *buffer, size_t num_bytes) {
     return buffer->size - buffer->offset >= num_bytes;
@@ -16,6 +16,8 @@
  ********************************************************************************/
 
 #include "stellar_types.h"
+#include "stellar_api.h"
+#include "stellar_jobs.h"
 #include "ux.h"
 
 stellar_context_t ctx;
@@ -25,6 +27,15 @@ bool called_from_swap;
 swap_values_t swap_values;
 
 void reset_ctx() {
+    jobs_clear();
+#ifdef HAVE_KEY_CACHES
+    strkey_cache_clear();
+#endif
+    pubkey_cache_clear();
+    clear_signing_key();
+#ifdef HAVE_TX_QUEUE
+    queue_clear();
+#endif
     explicit_bzero(&ctx, sizeof(ctx));
     if (!called_from_swap) {
         explicit_bzero(&swap_values, sizeof(swap_values));
@@ -0,0 +1,360 @@
+/*******************************************************************************
+ *   Ledger Stellar App
+ *   (c) 2017-2018 Ledger
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ ********************************************************************************/
+
+/*
+ * x86 SIMD kernels of the host build, used by the batch tools and benchmarks.
+ * Each kernel processes whole blocks and returns the number of input bytes it consumed,
+ * the caller finishes the remainder with the scalar code the device runs.
+ */
+#ifdef HAVE_HOST_SIMD
+
+#include <immintrin.h>
+#include <string.h>
+
+#include "stellar_api.h"
+
+static const char HEX_DIGITS[17] = "0123456789ABCDEF";
+
+__attribute__((target("ssse3")))
+size_t print_hex_ssse3(const uint8_t *in, size_t len, char *out) {
+    const __m128i digits = _mm_loadu_si128((const __m128i *) HEX_DIGITS);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    size_t done = 0;
+
+    for (; done + 16 <= len; done += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *) (in + done));
+        __m128i hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble));
+        __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, nibble));
+        _mm_storeu_si128((__m128i *) (out + 2 * done), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i *) (out + 2 * done + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    return done;
+}
+
+__attribute__((target("avx2")))
+size_t print_hex_avx2(const uint8_t *in, size_t len, char *out) {
+    const __m256i digits =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) HEX_DIGITS));
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    size_t done = 0;
+
+    for (; done + 32 <= len; done += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *) (in + done));
+        __m256i hi =
+            _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble));
+        __m256i lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(bytes, nibble));
+        // unpack works within 128-bit lanes: reorder the halves into input order
+        __m256i first = _mm256_unpacklo_epi8(hi, lo);
+        __m256i second = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256((__m256i *) (out + 2 * done),
+                            _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256((__m256i *) (out + 2 * done + 32),
+                            _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    return done + print_hex_ssse3(in + done, len - done, out + 2 * done);
+}
+
+static size_t print_hex_none(const uint8_t *in, size_t len, char *out) {
+    (void) in;
+    (void) len;
+    (void) out;
+    return 0;
+}
+
+size_t print_hex_simd(const uint8_t *in, size_t len, char *out) {
+    static size_t (*kernel)(const uint8_t *, size_t, char *);
+
+    if (kernel == NULL) {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            kernel = print_hex_avx2;
+        } else if (__builtin_cpu_supports("ssse3")) {
+            kernel = print_hex_ssse3;
+        } else {
+            kernel = print_hex_none;
+        }
+    }
+    return kernel(in, len, out);
+}
+
+/* CRC16-XModem nibble table, split in low and high bytes for byte shuffles */
+static const uint8_t CRC16_NIBBLE_LO[16] = {0x00, 0x21, 0x42, 0x63, 0x84, 0xa5, 0xc6, 0xe7,
+                                            0x08, 0x29, 0x4a, 0x6b, 0x8c, 0xad, 0xce, 0xef};
+static const uint8_t CRC16_NIBBLE_HI[16] = {0x00, 0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70,
+                                            0x81, 0x91, 0xa1, 0xb1, 0xc1, 0xd1, 0xe1, 0xf1};
+
+/* 16 x 16 bytes transpose: rows[r] byte c becomes rows[c] byte r */
+__attribute__((target("avx2")))
+static void transpose_16x16(__m128i *rows) {
+    __m128i a[16], b[16];
+    for (int i = 0; i < 8; i++) {
+        a[2 * i] = _mm_unpacklo_epi8(rows[2 * i], rows[2 * i + 1]);
+        a[2 * i + 1] = _mm_unpackhi_epi8(rows[2 * i], rows[2 * i + 1]);
+    }
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 2; j++) {
+            b[4 * i + j] = _mm_unpacklo_epi16(a[4 * i + j], a[4 * i + j + 2]);
+            b[4 * i + j + 2] = _mm_unpackhi_epi16(a[4 * i + j], a[4 * i + j + 2]);
+        }
+    }
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 4; j++) {
+            a[8 * i + j] = _mm_unpacklo_epi32(b[8 * i + j], b[8 * i + j + 4]);
+            a[8 * i + j + 4] = _mm_unpackhi_epi32(b[8 * i + j], b[8 * i + j + 4]);
+        }
+    }
+    for (int j = 0; j < 8; j++) {
+        b[j] = _mm_unpacklo_epi64(a[j], a[j + 8]);
+        b[j + 8] = _mm_unpackhi_epi64(a[j], a[j + 8]);
+    }
+    // undo the interleaving of the unpack stages: output k sits at bit-reversed position
+    for (int k = 0; k < 16; k++) {
+        int r = (k & 1) << 3 | (k & 2) << 1 | (k & 4) >> 1 | (k & 8) >> 3;
+        rows[k] = b[r];
+    }
+}
+
+/* 16 lanes of 5-bit values to base32 characters */
+__attribute__((target("avx2")))
+static __m128i base32_characters(__m256i values) {
+    __m256i letters = _mm256_add_epi16(values, _mm256_set1_epi16('A'));
+    __m256i digits = _mm256_and_si256(_mm256_cmpgt_epi16(values, _mm256_set1_epi16(25)),
+                                      _mm256_set1_epi16('2' - 26 - 'A'));
+    __m256i chars = _mm256_add_epi16(letters, digits);
+    return _mm_packus_epi16(_mm256_castsi256_si128(chars), _mm256_extracti128_si256(chars, 1));
+}
+
+/*
+ * Loads 4 * quads bytes of 16 records laid out stride bytes apart, transposed:
+ * lanes[j] holds byte j of every record, one 16-bit lane per record.
+ */
+__attribute__((target("avx2")))
+static void load_lanes(const uint8_t *records, int stride, int quads, __m256i *lanes) {
+    const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                               _mm256_set1_epi32(stride));
+    const __m256i byteMask = _mm256_set1_epi32(0xFF);
+
+    for (int q = 0; q < quads; q++) {
+        const int *first = (const int *) (records + 4 * q);
+        const int *second = (const int *) (records + 8 * stride + 4 * q);
+        __m256i a = _mm256_i32gather_epi32(first, offsets, 1);
+        __m256i b = _mm256_i32gather_epi32(second, offsets, 1);
+        for (int t = 0; t < 4; t++) {
+            __m256i x = _mm256_and_si256(_mm256_srli_epi32(a, 8 * t), byteMask);
+            __m256i y = _mm256_and_si256(_mm256_srli_epi32(b, 8 * t), byteMask);
+            // packing works within 128-bit halves, restore the record order
+            lanes[4 * q + t] = _mm256_permute4x64_epi64(_mm256_packus_epi32(x, y), 0xD8);
+        }
+    }
+}
+
+/* continues the CRC16-XModem of every lane over count bytes */
+__attribute__((target("avx2")))
+static __m256i crc16_lanes(__m256i crc, const __m256i *bytes, int count) {
+    const __m256i nibbleMask = _mm256_set1_epi16(0x0F);
+    const __m256i tableLo =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) CRC16_NIBBLE_LO));
+    const __m256i tableHi =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) CRC16_NIBBLE_HI));
+
+    for (int j = 0; j < count; j++) {
+        __m256i nibbles[2] = {_mm256_srli_epi16(bytes[j], 4),
+                              _mm256_and_si256(bytes[j], nibbleMask)};
+        for (int h = 0; h < 2; h++) {
+            __m256i idx = _mm256_xor_si256(_mm256_srli_epi16(crc, 12), nibbles[h]);
+            __m256i entry =
+                _mm256_or_si256(_mm256_shuffle_epi8(tableLo, idx),
+                                _mm256_slli_epi16(_mm256_shuffle_epi8(tableHi, idx), 8));
+            crc = _mm256_xor_si256(_mm256_slli_epi16(crc, 4), entry);
+        }
+    }
+    return crc;
+}
+
+/*
+ * Encodes 16 keys at a time with one 16-bit lane per key: the key bytes are gathered and
+ * transposed so that byte j of every key sits in the same register, the checksum and the
+ * base32 characters are computed lane-wise, and the characters are transposed back.
+ */
+__attribute__((target("avx2")))
+size_t encode_public_keys_avx2(const uint8_t (*keys)[32], size_t n, char (*out)[57]) {
+    // the version byte is the same for every key, so is the checksum after it
+    uint8_t version = STRKEY_VERSION_ACCOUNT_ID;
+    const __m256i crcVersion = _mm256_set1_epi16(crc16(&version, 1));
+    const __m256i fiveBits = _mm256_set1_epi16(31);
+    size_t done = 0;
+
+    for (; done + 16 <= n; done += 16) {
+        __m256i bytes[STRKEY_RAW_SIZE];
+
+        bytes[0] = _mm256_set1_epi16(version);
+        load_lanes(keys[done], 32, 8, bytes + 1);
+        __m256i crc = crc16_lanes(crcVersion, bytes + 1, 32);
+        bytes[33] = _mm256_and_si256(crc, _mm256_set1_epi16(0xFF));
+        bytes[34] = _mm256_srli_epi16(crc, 8);
+
+        __m128i chars[64];
+        for (int g = 0; g < STRKEY_RAW_SIZE / 5; g++) {
+            const __m256i *b = bytes + 5 * g;
+            __m256i w01 = _mm256_or_si256(_mm256_slli_epi16(b[0], 8), b[1]);
+            __m256i w12 = _mm256_or_si256(_mm256_slli_epi16(b[1], 8), b[2]);
+            __m256i w23 = _mm256_or_si256(_mm256_slli_epi16(b[2], 8), b[3]);
+            __m256i w34 = _mm256_or_si256(_mm256_slli_epi16(b[3], 8), b[4]);
+            __m128i *c = chars + 8 * g;
+            c[0] = base32_characters(_mm256_srli_epi16(w01, 11));
+            c[1] = base32_characters(_mm256_and_si256(_mm256_srli_epi16(w01, 6), fiveBits));
+            c[2] = base32_characters(_mm256_and_si256(_mm256_srli_epi16(w01, 1), fiveBits));
+            c[3] = base32_characters(_mm256_and_si256(_mm256_srli_epi16(w12, 4), fiveBits));
+            c[4] = base32_characters(_mm256_and_si256(_mm256_srli_epi16(w23, 7), fiveBits));
+            c[5] = base32_characters(_mm256_and_si256(_mm256_srli_epi16(w23, 2), fiveBits));
+            c[6] = base32_characters(_mm256_and_si256(_mm256_srli_epi16(w34, 5), fiveBits));
+            c[7] = base32_characters(_mm256_and_si256(w34, fiveBits));
+        }
+        for (int c = STRKEY_SIZE; c < 64; c++) {
+            chars[c] = _mm_setzero_si128();
+        }
+
+        for (int block = 0; block < 4; block++) {
+            transpose_16x16(chars + 16 * block);
+            for (int k = 0; k < 16; k++) {
+                if (block < 3) {
+                    _mm_storeu_si128((__m128i *) (out[done + k] + 16 * block),
+                                     chars[16 * block + k]);
+                } else {
+                    // the last 8 characters and the terminating zero
+                    _mm_storel_epi64((__m128i *) (out[done + k] + 48), chars[48 + k]);
+                    out[done + k][STRKEY_SIZE] = '\0';
+                }
+            }
+        }
+    }
+    return done;
+}
+
+size_t encode_public_keys_simd(const uint8_t (*keys)[32], size_t n, char (*out)[57]) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return encode_public_keys_avx2(keys, n, out);
+    }
+    return 0;
+}
+
+/* 16 lanes of base32 characters to 5-bit values, characters outside the alphabet flag invalid */
+__attribute__((target("avx2")))
+static __m256i base32_values(__m256i chars, __m256i *invalid) {
+    __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi16(chars, _mm256_set1_epi16('A' - 1)),
+                                      _mm256_cmpgt_epi16(_mm256_set1_epi16('Z' + 1), chars));
+    __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi16(chars, _mm256_set1_epi16('2' - 1)),
+                                     _mm256_cmpgt_epi16(_mm256_set1_epi16('7' + 1), chars));
+    __m256i outside = _mm256_andnot_si256(_mm256_or_si256(letter, digit), _mm256_set1_epi16(-1));
+    *invalid = _mm256_or_si256(*invalid, outside);
+    return _mm256_blendv_epi8(_mm256_sub_epi16(chars, _mm256_set1_epi16('2' - 26)),
+                              _mm256_sub_epi16(chars, _mm256_set1_epi16('A')),
+                              letter);
+}
+
+/*
+ * Decodes 16 StrKeys at a time, transposed like the encoder: characters are gathered into
+ * lanes, mapped to 5-bit values and regrouped into bytes, the version byte and the checksum
+ * are verified lane-wise and the key bytes are transposed back.
+ */
+__attribute__((target("avx2")))
+size_t decode_strkeys_avx2(const char (*in)[57],
+                           size_t n,
+                           uint8_t versionByte,
+                           uint8_t (*out)[32],
+                           uint8_t *valid) {
+    const __m256i byteMask = _mm256_set1_epi16(0xFF);
+    size_t done = 0;
+
+    for (; done + 16 <= n; done += 16) {
+        __m256i chars[STRKEY_SIZE];
+        __m256i bytes[STRKEY_RAW_SIZE];
+        __m256i invalid = _mm256_setzero_si256();
+
+        load_lanes((const uint8_t *) in[done], 57, STRKEY_SIZE / 4, chars);
+        for (int g = 0; g < STRKEY_RAW_SIZE / 5; g++) {
+            __m256i v[8];
+            for (int i = 0; i < 8; i++) {
+                v[i] = base32_values(chars[8 * g + i], &invalid);
+            }
+            __m256i *b = bytes + 5 * g;
+            b[0] = _mm256_or_si256(_mm256_slli_epi16(v[0], 3), _mm256_srli_epi16(v[1], 2));
+            b[1] = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi16(v[1], 6),
+                                                   _mm256_slli_epi16(v[2], 1)),
+                                   _mm256_srli_epi16(v[3], 4));
+            b[2] = _mm256_or_si256(_mm256_slli_epi16(v[3], 4), _mm256_srli_epi16(v[4], 1));
+            b[3] = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi16(v[4], 7),
+                                                   _mm256_slli_epi16(v[5], 2)),
+                                   _mm256_srli_epi16(v[6], 3));
+            b[4] = _mm256_or_si256(_mm256_slli_epi16(v[6], 5), v[7]);
+            for (int i = 0; i < 5; i++) {
+                b[i] = _mm256_and_si256(b[i], byteMask);
+            }
+        }
+
+        __m256i crc = crc16_lanes(_mm256_setzero_si256(), bytes, 33);
+        __m256i expected = _mm256_or_si256(bytes[33], _mm256_slli_epi16(bytes[34], 8));
+        __m256i version = _mm256_cmpeq_epi16(bytes[0], _mm256_set1_epi16(versionByte));
+        __m256i ok = _mm256_and_si256(_mm256_cmpeq_epi16(crc, expected), version);
+        ok = _mm256_andnot_si256(invalid, ok);
+
+        __m128i packed =
+            _mm_packs_epi16(_mm256_castsi256_si128(ok), _mm256_extracti128_si256(ok, 1));
+        uint16_t mask = _mm_movemask_epi8(packed);
+        for (int k = 0; k < 16; k++) {
+            // exactly 56 characters
+            if (in[done + k][STRKEY_SIZE] != '\0') {
+                mask &= ~(1 << k);
+            }
+        }
+        valid[done / 8] = mask;
+        valid[done / 8 + 1] = mask >> 8;
+
+        __m128i rows[32];
+        for (int j = 0; j < 32; j++) {
+            __m256i row = bytes[1 + j];
+            rows[j] =
+                _mm_packus_epi16(_mm256_castsi256_si128(row), _mm256_extracti128_si256(row, 1));
+        }
+        transpose_16x16(rows);
+        transpose_16x16(rows + 16);
+        for (int k = 0; k < 16; k++) {
+            _mm_storeu_si128((__m128i *) out[done + k], rows[k]);
+            _mm_storeu_si128((__m128i *) (out[done + k] + 16), rows[16 + k]);
+            if (!(mask & (1 << k))) {
+                // key bytes of invalid entries are cleared
+                memset(out[done + k], 0, 32);
+            }
+        }
+    }
+    return done;
+}
+
+size_t decode_strkeys_simd(const char (*in)[57],
+                           size_t n,
+                           uint8_t versionByte,
+                           uint8_t (*out)[32],
+                           uint8_t *valid) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return decode_strkeys_avx2(in, n, versionByte, out, valid);
+    }
+    return 0;
+}
+
+#endif  // HAVE_HOST_SIMD
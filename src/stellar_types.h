@@ -29,6 +29,9 @@
 #define INS_SIGN_TX               0x04
 #define INS_GET_APP_CONFIGURATION 0x06
 #define INS_SIGN_TX_HASH          0x08
+#define INS_GET_PUBLIC_KEYS       0x0A
+#define INS_SIGN_TX_HASHES        0x0C
+#define INS_QUEUE_TX              0x0E
 #define INS_KEEP_ALIVE            0x10
 #define P1_NO_SIGNATURE           0x00
 #define P1_SIGNATURE              0x01
@@ -36,6 +39,9 @@
 #define P2_CONFIRM                0x01
 #define P1_FIRST                  0x00
 #define P1_MORE                   0x80
+#define P1_FIRST_MULTI_PATH       0x01
+#define P1_NEXT_SIGNATURES        0x02
+#define P1_POLL                   0x01
 #define P2_LAST                   0x00
 #define P2_MORE                   0x80
 
@@ -56,14 +62,60 @@
 #endif
 /* For sure not more than 35 operations will fit in that */
 #define MAX_OPS 35
+
+/* signer keys of one transaction, 3 hints and signatures fill a response */
+#define MAX_SIGNING_PATHS 3
+
+/* hashes signed after a single approval, they are kept in the raw tx buffer */
+#define MAX_HASHES (MAX_RAW_TX / HASH_SIZE)
+
+/* signatures of a batch of hashes returned by one response */
+#define MAX_SIGNATURES_PER_APDU 3
+
+/* results of queued transactions kept until the host polls them */
+#define QUEUE_RESULTS 2
+
 /* Although SEP-0005 only allows 3 bip32 path elements we support more */
 #define MAX_BIP32_LEN 10
 
 /* max amount is max int64 scaled down: "922337203685.4775807" */
 #define AMOUNT_MAX_SIZE 21
 
+/* amounts are expressed in stroops: 1 XLM = 10000000 stroops */
+#define AMOUNT_DECIMALS 7
+
+/* prices smaller than 1 are printed with more decimals until this many significant digits */
+#define PRICE_SIGNIFICANT_DIGITS 7
+
 #define HASH_SIZE 32
 
+/* StrKey: version byte, 32 bytes key and 2 bytes checksum, base32 encoded in 56 characters */
+#define STRKEY_RAW_SIZE            35
+#define STRKEY_SIZE                56
+#define STRKEY_VERSION_ACCOUNT_ID  (6 << 3)
+#define STRKEY_VERSION_PRE_AUTH_TX (19 << 3)
+#define STRKEY_VERSION_HASH_X      (23 << 3)
+
+#ifdef HAVE_KEY_CACHES
+/* StrKeys encoded ahead of time for the upcoming screens */
+#define STRKEY_CACHE_SIZE 3
+
+/* public keys derived during the session, keyed by bip32 path */
+#define PUBKEY_CACHE_SIZE 4
+
+/* public keys kept in NVRAM across launches when key caching is enabled, truncated mac size */
+#define NV_PUBKEY_CACHE_SIZE 4
+#define NV_PUBKEY_TAG_SIZE   16
+#endif
+
+/* journal of the persistent state: 32 bytes records, at most NV_COMMIT_RECORDS per commit */
+#define NV_JOURNAL_SIZE     16
+#define NV_RECORD_DATA_SIZE 22
+#define NV_COMMIT_RECORDS   5
+
+/* consecutive public keys returned by one INS_GET_PUBLIC_KEYS response: count byte + 7 keys */
+#define MAX_PUBLIC_KEYS_PER_APDU 7
+
 // ------------------------------------------------------------------------- //
 //                       TRANSACTION PARSING CONSTANTS                       //
 // ------------------------------------------------------------------------- //
@@ -113,13 +165,9 @@ typedef enum {
 //                             DISPLAY CONSTANTS                             //
 // ------------------------------------------------------------------------- //
 
-/*
- * Longest string will be "Operation ii of nn"
- */
-#define OPERATION_CAPTION_MAX_SIZE 20
-
 /*
  * Captions don't scroll so there is no use in having more capacity than can fit on screen at once.
+ * Longest string will be "Operation ii of nn"
  */
 #define DETAIL_CAPTION_MAX_SIZE 20
 
@@ -137,19 +185,34 @@ static const char *NETWORK_NAMES[3] = {"Public", "Test", "Unknown"};
 //                              UTILITIES                                    //
 // ------------------------------------------------------------------------- //
 
-#ifdef TEST
+#if defined(SOFTSIGN)
+#include <string.h>
+
+/* ends the review of the envelope that raised code, see softsign.c */
+__attribute__((noreturn)) void softsign_throw(unsigned short code);
+#define THROW(code) softsign_throw(code)
+#define PRINTF(...)
+#define PIC(code)   code
+
+#define MEMCLEAR(dest)                       \
+    do {                                     \
+        explicit_bzero(&dest, sizeof(dest)); \
+    } while (0)
+#elif defined(TEST)
 #include <stdio.h>
 #include <string.h>
 
+#ifndef THROW  // the host os.h has exceptions
 #define THROW(code)                \
     do {                           \
         printf("error: %d", code); \
     } while (0)
+#endif
 
 #ifdef FUZZ
 #define PRINTF(...)
 #else
-#define PRINTF(strbuf, ...) fprintf(stderr, strbuf, __VA_ARGS__)
+#define PRINTF(...) fprintf(stderr, __VA_ARGS__)
 #endif  // FUZZ
 #define PIC(code) code
 
@@ -160,7 +223,14 @@ static const char *NETWORK_NAMES[3] = {"Public", "Test", "Unknown"};
         explicit_bzero(&dest, sizeof(dest)); \
     } while (0)
 #include "bolos_target.h"
-#endif  // TEST
+#endif  // SOFTSIGN, TEST
+
+/* the software signer runs one review per thread, the app has a single one */
+#ifdef SOFTSIGN
+#define APP_THREAD_LOCAL __thread
+#else
+#define APP_THREAD_LOCAL
+#endif
 
 // ------------------------------------------------------------------------- //
 //                           TYPE DEFINITIONS                                //
@@ -346,8 +416,10 @@ typedef struct {
 } pk_context_t;
 
 typedef struct {
-    uint8_t bip32Len;
-    uint32_t bip32[MAX_BIP32_LEN];
+    uint8_t pathCount;
+    bool multiPath;  // reply with a hint before each signature
+    uint8_t bip32Len[MAX_SIGNING_PATHS];
+    uint32_t bip32[MAX_SIGNING_PATHS][MAX_BIP32_LEN];
     uint8_t raw[MAX_RAW_TX];
     uint32_t rawLength;
     uint8_t hash[HASH_SIZE];
@@ -357,12 +429,30 @@ typedef struct {
     tx_details_t txDetails;
     uint8_t opCount;
     uint8_t opIdx;
+    uint8_t hashCount;    // hashes in raw when signing a batch of hashes
+    uint8_t signedCount;  // hashes of the batch already signed and returned
+    bool queued;          // reviewed in a queued session, the host polls for the result
+    uint8_t queueId;
     uint32_t tx;
 } tx_context_t;
 
 enum request_type_t { CONFIRM_ADDRESS, CONFIRM_TRANSACTION };
 
-enum app_state_t { STATE_NONE, STATE_PARSE_TX, STATE_APPROVE_TX, STATE_APPROVE_TX_HASH };
+enum queue_status_t {
+    QUEUE_STATUS_PENDING,
+    QUEUE_STATUS_SIGNED,
+    QUEUE_STATUS_REJECTED,
+    QUEUE_STATUS_INVALID
+};
+
+enum app_state_t {
+    STATE_NONE,
+    STATE_PARSE_TX,
+    STATE_APPROVE_TX,
+    STATE_APPROVE_TX_HASH,
+    STATE_APPROVE_TX_HASHES,
+    STATE_SEND_SIGNATURES
+};
 
 typedef struct {
     enum app_state_t state;
@@ -374,15 +464,56 @@ typedef struct {
     int16_t u2fTimer;
 } stellar_context_t;
 
+#ifdef HAVE_KEY_CACHES
+typedef struct {
+    uint8_t bip32Len;
+    uint32_t bip32[MAX_BIP32_LEN];
+    uint8_t publicKey[32];
+    uint8_t tag[NV_PUBKEY_TAG_SIZE];  // mac of the fields above, keyed by a secret of the seed
+    uint32_t lastUse;  // not tagged, it only orders the evictions: the lowest one goes first
+} nv_pubkey_entry_t;
+#endif
+
 typedef struct {
     uint8_t initialized;
     uint8_t hashSigning;
+#ifdef HAVE_KEY_CACHES
+    uint8_t pubkeyCaching;
+    nv_pubkey_entry_t pubkeyCache[NV_PUBKEY_CACHE_SIZE];
+#endif
 } stellar_nv_state_t;
 
+/* bytes of the state changed by a commit, a commit is complete with its NV_RECORD_LAST record */
+#define NV_RECORD_LAST 0x01
+
+typedef struct {
+    uint32_t version;  // commit of the record, one more than the previous commit
+    uint16_t offset;   // of data in stellar_nv_state_t
+    uint8_t length;
+    uint8_t flags;
+    uint8_t data[NV_RECORD_DATA_SIZE];
+    uint16_t crc;  // crc16 of the fields above
+} nv_record_t;
+
+typedef struct {
+    uint32_t version;  // last commit included in the state
+    stellar_nv_state_t state;
+    uint16_t crc;  // crc16 of the fields above
+} nv_snapshot_t;
+
+/*
+ * NVRAM layout: the commits made since the snapshot, in order, page aligned, then two snapshot
+ * slots written in turn. A torn snapshot leaves the previous one and its journal intact.
+ */
+typedef struct {
+    nv_record_t journal[NV_JOURNAL_SIZE];
+    nv_snapshot_t snapshots[2];
+} stellar_nv_store_t;
+
 typedef struct {
     uint64_t amount;
     uint64_t fees;
-    char destination[57];
+    uint8_t destination[32];
     char memo[20];
 } swap_values_t;
 
@@ -24,11 +24,9 @@
 
 #include "bolos_target.h"
 
-static const char hexAlphabet[] = "0123456789ABCDEF";
 static const char base32Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
 static const char base64Alphabet[] =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-static int base64ModTable[] = {0, 2, 1};
 
 bool parse_bip32_path(uint8_t *path,
                       size_t path_length,
@@ -46,129 +44,442 @@ bool parse_bip32_path(uint8_t *path,
     return true;
 }
 
-unsigned short crc16(char *ptr, int count) {
-    int crc;
-    crc = 0;
-    while (--count >= 0) {
-        crc = crc ^ (int) *ptr++ << 8;
-        int i = 8;
-        do {
-            if (crc & 0x8000)
-                crc = crc << 1 ^ 0x1021;
-            else
-                crc = crc << 1;
-        } while (--i);
+/* CRC16-XModem (polynomial 0x1021, initial value 0) */
+static const uint16_t CRC16_NIBBLE_TABLE[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+};
+
+uint16_t crc16_nibble(const uint8_t *data, size_t length) {
+    uint16_t crc = 0;
+    while (length--) {
+        crc = (crc << 4) ^ CRC16_NIBBLE_TABLE[(crc >> 12) ^ (*data >> 4)];
+        crc = (crc << 4) ^ CRC16_NIBBLE_TABLE[(crc >> 12) ^ (*data & 0x0f)];
+        data++;
     }
-    return (crc);
+    return crc;
 }
 
-/**
- * adapted from
- * https://stash.forgerock.org/projects/OPENAM/repos/forgerock-authenticator-ios/browse/ForgeRock-Authenticator/base32.c
- */
-int base32_encode(const uint8_t *data, int length, char *result, int bufSize) {
-    int count = 0;
-
-    if (length < 0 || length > (1 << 28)) {
-        return -1;
+#if defined(HAVE_CRC16_BYTE_TABLE) || defined(TEST)
+static const uint16_t CRC16_BYTE_TABLE[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
+    0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
+    0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
+    0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
+    0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
+    0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
+    0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
+    0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
+    0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
+    0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
+    0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
+    0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
+    0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
+    0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
+    0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
+    0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
+    0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
+    0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
+    0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
+    0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
+    0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
+    0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0,
+};
+
+uint16_t crc16_byte(const uint8_t *data, size_t length) {
+    uint16_t crc = 0;
+    while (length--) {
+        crc = (crc << 8) ^ CRC16_BYTE_TABLE[(crc >> 8) ^ *data++];
     }
-
-    if (length > 0) {
-        int buffer = data[0];
-        int next = 1;
-        int bitsLeft = 8;
-        int quantum = 8;
-
-        while (count < bufSize && (bitsLeft > 0 || next < length)) {
-            if (bitsLeft < 5) {
-                if (next < length) {
-                    buffer <<= 8;
-                    buffer |= data[next++] & 0xFF;
-                    bitsLeft += 8;
-                } else {
-                    int pad = 5 - bitsLeft;
-                    buffer <<= pad;
-                    bitsLeft += pad;
-                }
-            }
-
-            int idx = 0x1F & (buffer >> (bitsLeft - 5));
-            bitsLeft -= 5;
-            result[count++] = base32Alphabet[idx];
-
-            // Track the characters which make up a single quantum of 8 characters
-            quantum--;
-            if (quantum == 0) {
-                quantum = 8;
-            }
+    return crc;
+}
+#endif
+
+#ifdef TEST
+/* CRC16_SLICE_TABLES[k][v]: crc of byte v followed by k zero bytes */
+static APP_THREAD_LOCAL uint16_t CRC16_SLICE_TABLES[4][256];
+
+static void crc16_slice_init(void) {
+    for (int v = 0; v < 256; v++) {
+        uint16_t crc = CRC16_BYTE_TABLE[v];
+        CRC16_SLICE_TABLES[0][v] = crc;
+        for (int k = 1; k < 4; k++) {
+            crc = (crc << 8) ^ CRC16_BYTE_TABLE[crc >> 8];
+            CRC16_SLICE_TABLES[k][v] = crc;
         }
+    }
+}
 
-        // If the number of encoded characters does not make a full quantum, insert padding
-        if (quantum != 8) {
-            while (quantum > 0 && count < bufSize) {
-                result[count++] = '=';
-                quantum--;
-            }
-        }
+uint16_t crc16_slice4(const uint8_t *data, size_t length) {
+    if (CRC16_SLICE_TABLES[0][1] == 0) {
+        crc16_slice_init();
+    }
+    uint16_t crc = 0;
+    for (; length >= 4; length -= 4, data += 4) {
+        uint16_t head = crc ^ (data[0] << 8 | data[1]);
+        crc = CRC16_SLICE_TABLES[3][head >> 8] ^ CRC16_SLICE_TABLES[2][head & 0xff] ^
+              CRC16_SLICE_TABLES[1][data[2]] ^ CRC16_SLICE_TABLES[0][data[3]];
+    }
+    while (length--) {
+        crc = (crc << 8) ^ CRC16_BYTE_TABLE[(crc >> 8) ^ *data++];
     }
+    return crc;
+}
+#endif
+
+uint16_t crc16(const uint8_t *data, size_t length) {
+#if defined(TEST)
+    return crc16_slice4(data, length);
+#elif defined(HAVE_CRC16_BYTE_TABLE)
+    return crc16_byte(data, length);
+#else
+    return crc16_nibble(data, length);
+#endif
+}
 
-    // Finally check if we exceeded buffer size.
-    if (count < bufSize) {
-        result[count] = '\000';
-        return count;
-    } else {
-        return -1;
+/* encodes the (up to) 3 bytes of a base64 quantum into 4 characters, padded with '=' */
+static void base64_encode_quantum(const uint8_t *data, size_t remaining, char *out) {
+    uint32_t triple = data[0] << 16;
+    if (remaining > 1) {
+        triple |= data[1] << 8;
+    }
+    if (remaining > 2) {
+        triple |= data[2];
     }
+    out[0] = base64Alphabet[triple >> 18];
+    out[1] = base64Alphabet[(triple >> 12) & 0x3F];
+    out[2] = remaining > 1 ? base64Alphabet[(triple >> 6) & 0x3F] : '=';
+    out[3] = remaining > 2 ? base64Alphabet[triple & 0x3F] : '=';
 }
 
 void base64_encode(const uint8_t *data, int inLen, char *out) {
-    size_t outLen = 4 * ((inLen + 2) / 3);
-
-    for (int i = 0, j = 0; i < inLen;) {
-        uint32_t octet_a = i < inLen ? data[i++] : 0;
-        uint32_t octet_b = i < inLen ? data[i++] : 0;
-        uint32_t octet_c = i < inLen ? data[i++] : 0;
+    int i = 0;
+
+    // full quanta, 3 bytes to 4 characters without branches
+    for (; i + 3 <= inLen; i += 3) {
+        uint32_t triple = data[i] << 16 | data[i + 1] << 8 | data[i + 2];
+        out[0] = base64Alphabet[triple >> 18];
+        out[1] = base64Alphabet[(triple >> 12) & 0x3F];
+        out[2] = base64Alphabet[(triple >> 6) & 0x3F];
+        out[3] = base64Alphabet[triple & 0x3F];
+        out += 4;
+    }
+    if (i < inLen) {
+        base64_encode_quantum(data + i, inLen - i, out);
+        out += 4;
+    }
+    *out = '\0';
+}
 
-        uint32_t triple = (octet_a << 0x10) + (octet_b << 0x08) + octet_c;
+void print_base64_summary(const uint8_t *data,
+                          size_t len,
+                          char *out,
+                          uint8_t numCharsL,
+                          uint8_t numCharsR) {
+    size_t encodedLen = 4 * ((len + 2) / 3);
+    char quantum[4];
 
-        out[j++] = base64Alphabet[(triple >> 3 * 6) & 0x3F];
-        out[j++] = base64Alphabet[(triple >> 2 * 6) & 0x3F];
-        out[j++] = base64Alphabet[(triple >> 1 * 6) & 0x3F];
-        out[j++] = base64Alphabet[(triple >> 0 * 6) & 0x3F];
+    if (encodedLen <= (size_t) numCharsL + numCharsR + 2) {
+        base64_encode(data, len, out);
+        return;
     }
-
-    int i;
-    for (i = 0; i < base64ModTable[inLen % 3]; i++) {
-        out[outLen - 1 - i] = '=';
+    for (size_t i = 0; i < numCharsL; i++) {
+        if (i % 4 == 0) {
+            base64_encode_quantum(data + i / 4 * 3, len - i / 4 * 3, quantum);
+        }
+        out[i] = quantum[i % 4];
+    }
+    out[numCharsL] = '.';
+    out[numCharsL + 1] = '.';
+    out += numCharsL + 2;
+    // the tail starts inside the quantum of input offset 3 * ((encodedLen - numCharsR) / 4)
+    for (size_t i = encodedLen - numCharsR; i < encodedLen; i++) {
+        if (i % 4 == 0 || i == encodedLen - numCharsR) {
+            base64_encode_quantum(data + i / 4 * 3, len - i / 4 * 3, quantum);
+        }
+        *out++ = quantum[i % 4];
     }
+    *out = '\0';
+}
 
-    out[outLen] = '\0';
+/* base32 encode a 5 bytes group into 8 characters */
+static void base32_encode_group(const uint8_t *in, char *out) {
+    out[0] = base32Alphabet[in[0] >> 3];
+    out[1] = base32Alphabet[((in[0] & 0x07) << 2) | (in[1] >> 6)];
+    out[2] = base32Alphabet[(in[1] >> 1) & 0x1F];
+    out[3] = base32Alphabet[((in[1] & 0x01) << 4) | (in[2] >> 4)];
+    out[4] = base32Alphabet[((in[2] & 0x0F) << 1) | (in[3] >> 7)];
+    out[5] = base32Alphabet[(in[3] >> 2) & 0x1F];
+    out[6] = base32Alphabet[((in[3] & 0x03) << 3) | (in[4] >> 5)];
+    out[7] = base32Alphabet[in[4] & 0x1F];
 }
 
-void encode_key(const uint8_t *in, char *out, uint8_t versionByte) {
-    uint8_t buffer[35];
-    buffer[0] = versionByte;
-    int i;
-    for (i = 0; i < 32; i++) {
-        buffer[i + 1] = in[i];
+/* 35 raw bytes to the 56 characters of a StrKey, no padding needed */
+static void base32_encode_strkey(const uint8_t *in, char *out) {
+    for (uint8_t i = 0; i < STRKEY_RAW_SIZE / 5; i++) {
+        base32_encode_group(in + 5 * i, out + 8 * i);
     }
-    short crc = crc16((char *) buffer, 33);  // checksum
+}
+
+/* version byte, key and checksum, ready to be base32 encoded */
+static void build_key(const uint8_t *in, uint8_t versionByte, uint8_t *buffer) {
+    buffer[0] = versionByte;
+    memcpy(buffer + 1, in, 32);
+    uint16_t crc = crc16(buffer, 33);  // checksum
     buffer[33] = crc;
     buffer[34] = crc >> 8;
-    base32_encode(buffer, 35, out, 56);
-    out[56] = '\0';
+}
+
+void encode_key(const uint8_t *in, char *out, uint8_t versionByte) {
+    uint8_t buffer[STRKEY_RAW_SIZE];
+    build_key(in, versionByte, buffer);
+    base32_encode_strkey(buffer, out);
+    out[STRKEY_SIZE] = '\0';
 }
 
 void encode_public_key(const uint8_t *in, char *out) {
-    encode_key(in, out, 6 << 3);
+    encode_key(in, out, STRKEY_VERSION_ACCOUNT_ID);
+}
+
+void encode_public_keys_bulk(const uint8_t (*keys)[32], size_t n, char (*out)[57]) {
+    size_t done = 0;
+#ifdef HAVE_HOST_SIMD
+    done = encode_public_keys_simd(keys, n, out);
+#endif
+    for (; done < n; done++) {
+        encode_public_key(keys[done], out[done]);
+    }
 }
 
 void encode_pre_auth_key(const uint8_t *in, char *out) {
-    encode_key(in, out, 19 << 3);
+    encode_key(in, out, STRKEY_VERSION_PRE_AUTH_TX);
 }
 
 void encode_hash_x_key(const uint8_t *in, char *out) {
-    encode_key(in, out, 23 << 3);
+    encode_key(in, out, STRKEY_VERSION_HASH_X);
+}
+
+/* base32 decode 8 characters into a 5 bytes group, false when one is not in the alphabet */
+static bool base32_decode_group(const char *in, uint8_t *out) {
+    uint8_t v[8];
+    for (uint8_t i = 0; i < 8; i++) {
+        if (in[i] >= 'A' && in[i] <= 'Z') {
+            v[i] = in[i] - 'A';
+        } else if (in[i] >= '2' && in[i] <= '7') {
+            v[i] = in[i] - '2' + 26;
+        } else {
+            return false;
+        }
+    }
+    out[0] = v[0] << 3 | v[1] >> 2;
+    out[1] = v[1] << 6 | v[2] << 1 | v[3] >> 4;
+    out[2] = v[3] << 4 | v[4] >> 1;
+    out[3] = v[4] << 7 | v[5] << 2 | v[6] >> 3;
+    out[4] = v[6] << 5 | v[7];
+    return true;
+}
+
+bool decode_strkey(const char *in, uint8_t versionByte, uint8_t *out) {
+    uint8_t buffer[STRKEY_RAW_SIZE];
+
+    if (strnlen(in, STRKEY_SIZE + 1) != STRKEY_SIZE) {
+        return false;
+    }
+    for (uint8_t i = 0; i < STRKEY_RAW_SIZE / 5; i++) {
+        if (!base32_decode_group(in + 8 * i, buffer + 5 * i)) {
+            return false;
+        }
+    }
+    uint16_t crc = crc16(buffer, 33);
+    if (buffer[0] != versionByte || buffer[33] != (uint8_t) crc || buffer[34] != crc >> 8) {
+        return false;
+    }
+    memcpy(out, buffer + 1, 32);
+    return true;
+}
+
+void decode_strkeys_bulk(const char (*in)[57],
+                         size_t n,
+                         uint8_t versionByte,
+                         uint8_t (*out)[32],
+                         uint8_t *valid) {
+    size_t done = 0;
+    memset(valid, 0, (n + 7) / 8);
+#ifdef HAVE_HOST_SIMD
+    done = decode_strkeys_simd(in, n, versionByte, out, valid);
+#endif
+    for (; done < n; done++) {
+        if (decode_strkey(in[done], versionByte, out[done])) {
+            valid[done / 8] |= 1 << (done % 8);
+        } else {
+            memset(out[done], 0, 32);
+        }
+    }
+}
+
+#ifdef HAVE_KEY_CACHES
+/*
+ * Full StrKey encodings of the keys shown on the upcoming screens, computed ahead of time by a
+ * background job. Entries hold a copy of the key so that a hit never depends on the buffer the key
+ * pointer refers to.
+ */
+typedef struct {
+    bool used;
+    uint8_t versionByte;
+    uint8_t key[32];
+    char encoded[STRKEY_SIZE];
+} strkey_cache_entry_t;
+
+static APP_THREAD_LOCAL strkey_cache_entry_t strkeyCache[STRKEY_CACHE_SIZE];
+static APP_THREAD_LOCAL uint8_t strkeyCacheNext;
+
+static const char *strkey_cache_lookup(const uint8_t *in, uint8_t versionByte) {
+    for (uint8_t i = 0; i < STRKEY_CACHE_SIZE; i++) {
+        if (strkeyCache[i].used && strkeyCache[i].versionByte == versionByte &&
+            memcmp(strkeyCache[i].key, in, 32) == 0) {
+            return strkeyCache[i].encoded;
+        }
+    }
+    return NULL;
+}
+
+void strkey_cache_warm(const uint8_t *in, uint8_t versionByte) {
+    if (strkey_cache_lookup(in, versionByte) != NULL) {
+        return;
+    }
+
+    char encoded[STRKEY_SIZE + 1];
+    strkey_cache_entry_t *entry = &strkeyCache[strkeyCacheNext];
+    strkeyCacheNext = (strkeyCacheNext + 1) % STRKEY_CACHE_SIZE;
+
+    encode_key(in, encoded, versionByte);
+    entry->used = true;
+    entry->versionByte = versionByte;
+    memcpy(entry->key, in, 32);
+    memcpy(entry->encoded, encoded, STRKEY_SIZE);
+}
+
+void strkey_cache_clear(void) {
+    MEMCLEAR(strkeyCache);
+    strkeyCacheNext = 0;
+}
+
+/*
+ * Public keys derived during the session. Wallets poll the same few paths, a hit answers them
+ * without going through the seed. Only public data is kept.
+ */
+typedef struct {
+    bool used;
+    uint8_t bip32Len;
+    uint32_t bip32[MAX_BIP32_LEN];
+    uint8_t publicKey[32];
+} pubkey_cache_entry_t;
+
+static APP_THREAD_LOCAL pubkey_cache_entry_t pubkeyCache[PUBKEY_CACHE_SIZE];
+static APP_THREAD_LOCAL uint8_t pubkeyCacheNext;
+
+static pubkey_cache_entry_t *pubkey_cache_find(const uint32_t *bip32, uint8_t bip32Len) {
+    if (bip32Len > MAX_BIP32_LEN) {
+        return NULL;
+    }
+    for (uint8_t i = 0; i < PUBKEY_CACHE_SIZE; i++) {
+        if (pubkeyCache[i].used && pubkeyCache[i].bip32Len == bip32Len &&
+            memcmp(pubkeyCache[i].bip32, bip32, bip32Len * sizeof(uint32_t)) == 0) {
+            return &pubkeyCache[i];
+        }
+    }
+    return NULL;
+}
+
+bool pubkey_cache_lookup(const uint32_t *bip32, uint8_t bip32Len, uint8_t *publicKey) {
+    const pubkey_cache_entry_t *entry = pubkey_cache_find(bip32, bip32Len);
+    if (entry == NULL) {
+        return false;
+    }
+    memcpy(publicKey, entry->publicKey, 32);
+    return true;
+}
+
+void pubkey_cache_store(const uint32_t *bip32, uint8_t bip32Len, const uint8_t *publicKey) {
+    if (bip32Len > MAX_BIP32_LEN) {
+        return;
+    }
+    pubkey_cache_entry_t *entry = pubkey_cache_find(bip32, bip32Len);
+    if (entry == NULL) {
+        entry = &pubkeyCache[pubkeyCacheNext];
+        pubkeyCacheNext = (pubkeyCacheNext + 1) % PUBKEY_CACHE_SIZE;
+    }
+    entry->used = true;
+    entry->bip32Len = bip32Len;
+    memcpy(entry->bip32, bip32, bip32Len * sizeof(uint32_t));
+    memcpy(entry->publicKey, publicKey, 32);
+}
+
+void pubkey_cache_clear(void) {
+    MEMCLEAR(pubkeyCache);
+    pubkeyCacheNext = 0;
+}
+#endif
+
+void print_strkey(const uint8_t *in,
+                  uint8_t versionByte,
+                  char *out,
+                  uint8_t numCharsL,
+                  uint8_t numCharsR) {
+    bool full = numCharsL == 0 || numCharsL + numCharsR + 2 >= STRKEY_SIZE;
+
+#ifdef HAVE_KEY_CACHES
+    const char *cached = strkey_cache_lookup(in, versionByte);
+    if (cached != NULL) {
+        if (full) {
+            memcpy(out, cached, STRKEY_SIZE);
+            out[STRKEY_SIZE] = '\0';
+        } else {
+            memcpy(out, cached, numCharsL);
+            out[numCharsL] = '.';
+            out[numCharsL + 1] = '.';
+            memcpy(out + numCharsL + 2, cached + STRKEY_SIZE - numCharsR, numCharsR);
+            out[numCharsL + numCharsR + 2] = '\0';
+        }
+        return;
+    }
+#endif
+    if (full) {
+        encode_key(in, out, versionByte);
+        return;
+    }
+
+    // only the 5 bytes groups holding the leading and trailing characters are encoded
+    uint8_t buffer[STRKEY_RAW_SIZE];
+    char group[8];
+    uint8_t i, j = 0;
+
+    build_key(in, versionByte, buffer);
+    for (i = 0; i < numCharsL; i += 8) {
+        base32_encode_group(buffer + i / 8 * 5, group);
+        for (uint8_t c = 0; c < 8 && i + c < numCharsL; c++) {
+            out[j++] = group[c];
+        }
+    }
+    out[j++] = '.';
+    out[j++] = '.';
+    for (i = STRKEY_SIZE - numCharsR; i < STRKEY_SIZE; i = (i / 8 + 1) * 8) {
+        base32_encode_group(buffer + i / 8 * 5, group);
+        for (uint8_t c = i % 8; c < 8; c++) {
+            out[j++] = group[c];
+        }
+    }
+    out[j] = '\0';
 }
 
 void print_summary(const char *in, char *out, uint8_t numCharsL, uint8_t numCharsR) {
@@ -185,124 +496,327 @@ void print_summary(const char *in, char *out, uint8_t numCharsL, uint8_t numChar
     }
 }
 
+/* hexadecimal digits of every byte value */
+static const char HEX_PAIRS[513] =
+    "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+static void print_hex_bytes(const uint8_t *in, size_t len, char *out) {
+    for (size_t i = 0; i < len; i++) {
+        out[2 * i] = HEX_PAIRS[2 * in[i]];
+        out[2 * i + 1] = HEX_PAIRS[2 * in[i] + 1];
+    }
+}
+
+void print_hex(const uint8_t *in, size_t len, char *out) {
+#ifdef HAVE_HOST_SIMD
+    size_t done = print_hex_simd(in, len, out);
+    in += done;
+    out += 2 * done;
+    len -= done;
+#endif
+    print_hex_bytes(in, len, out);
+    out[2 * len] = '\0';
+}
+
 void print_binary(const uint8_t *in, char *out, uint8_t len) {
     out[0] = '0';
     out[1] = 'x';
-    uint8_t i, j;
-    for (i = 0, j = 2; i < len; i += 1, j += 2) {
-        out[j] = hexAlphabet[in[i] / 16];
-        out[j + 1] = hexAlphabet[in[i] % 16];
-    }
-    out[j] = '\0';
+    print_hex(in, len, out + 2);
 }
 
 void print_binary_summary(const uint8_t *in, char *out, uint8_t len) {
-    out[0] = '0';
-    out[1] = 'x';
     if (2 + len * 2 > 18) {
-        uint8_t i, j;
-        for (i = 0, j = 2; i < 3; i += 1, j += 2) {
-            out[j] = hexAlphabet[in[i] / 16];
-            out[j + 1] = hexAlphabet[in[i] % 16];
-        }
-        out[j++] = '.';
-        out[j++] = '.';
-        for (i = len - 3; i < len; i += 1, j += 2) {
-            out[j] = hexAlphabet[in[i] / 16];
-            out[j + 1] = hexAlphabet[in[i] % 16];
-        }
-        out[j] = '\0';
+        // only the 3 leading and 3 trailing bytes are shown
+        out[0] = '0';
+        out[1] = 'x';
+        print_hex_bytes(in, 3, out + 2);
+        out[8] = '.';
+        out[9] = '.';
+        print_hex_bytes(in + len - 3, 3, out + 10);
+        out[16] = '\0';
     } else {
         print_binary(in, out, len);
-        return;
     }
 }
 
 void print_public_key(MuxedAccount in, char *out, uint8_t numCharsL, uint8_t numCharsR) {
-    if (numCharsL > 0) {
-        char buffer[57];
-        encode_public_key(in, buffer);
-        print_summary(buffer, out, numCharsL, numCharsR);
-    } else {
-        encode_public_key(in, out);
+    print_strkey(in, STRKEY_VERSION_ACCOUNT_ID, out, numCharsL, numCharsR);
+}
+
+void strbuf_init(strbuf_t *buf, char *ptr, size_t size) {
+    buf->ptr = ptr;
+    buf->len = 0;
+    buf->size = size;
+    buf->truncated = size == 0;
+    if (size != 0) {
+        ptr[0] = '\0';
     }
 }
 
-int print_asset_name(const Asset *asset, uint8_t network_id, char *out, size_t out_len) {
+void strbuf_append_n(strbuf_t *buf, const char *str, size_t len) {
+    if (buf->size == 0) {
+        buf->truncated = true;
+        return;
+    }
+    size_t room = buf->size - 1 - buf->len;
+    if (len > room) {
+        len = room;
+        buf->truncated = true;
+    }
+    memcpy(buf->ptr + buf->len, str, len);
+    buf->len += len;
+    buf->ptr[buf->len] = '\0';
+}
+
+void strbuf_append(strbuf_t *buf, const char *str) {
+    strbuf_append_n(buf, str, strlen(str));
+}
+
+int print_asset_name(const Asset *asset, uint8_t network_id, strbuf_t *out) {
     switch (asset->type) {
         case ASSET_TYPE_NATIVE:
-            print_native_asset_code(network_id, out, out_len);
+            print_native_asset_code(network_id, out);
             return 0;
         case ASSET_TYPE_CREDIT_ALPHANUM4:
-            for (int i = 0; i < 4; i++) {
-                out[i] = asset->assetCode[i];
-                if (out[i] == 0) {
-                    break;
-                }
-            }
-            out[4] = 0;
+            strbuf_append_n(out, asset->assetCode, strnlen(asset->assetCode, 4));
             return 0;
         case ASSET_TYPE_CREDIT_ALPHANUM12:
-            for (int i = 0; i < 12; i++) {
-                out[i] = asset->assetCode[i];
-                if (out[i] == 0) {
-                    break;
-                }
-            }
-            out[12] = 0;
+            strbuf_append_n(out, asset->assetCode, strnlen(asset->assetCode, 12));
             return 0;
         default:
             return -1;
     }
 }
 
+/* appends " " and the asset name */
+static void append_asset_name(const Asset *asset, uint8_t network_id, strbuf_t *out) {
+    strbuf_append(out, " ");
+    print_asset_name(asset, network_id, out);
+}
+
+static const char DIGIT_PAIRS[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const uint32_t POWERS_OF_TEN[9] =
+    {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+
+/* writes the `digits` lowest decimal digits of n, two at a time, no division */
+static void print_uint32_digits(uint32_t n, char *out, uint8_t digits) {
+    while (digits >= 2) {
+        uint32_t q = ((uint64_t) n * 0x51EB851F) >> 37;  // n / 100
+        uint32_t r = n - q * 100;
+        digits -= 2;
+        out[digits] = DIGIT_PAIRS[2 * r];
+        out[digits + 1] = DIGIT_PAIRS[2 * r + 1];
+        n = q;
+    }
+    if (digits) {
+        out[0] = '0' + n;
+    }
+}
+
+/* decimal digits of n without leading zeros, at most 20, returns their count */
+static uint8_t print_uint64_digits(uint64_t n, char *out) {
+    uint32_t chunks[2];
+    uint8_t chunkCount = 0;
+
+    // at most two 64-bit divisions, then everything is 32-bit
+    while (n >= 1000000000) {
+        uint64_t q = n / 1000000000;
+        chunks[chunkCount++] = n - q * 1000000000;
+        n = q;
+    }
+    uint8_t digits = 1;
+    while (digits < 9 && n >= POWERS_OF_TEN[digits]) {
+        digits++;
+    }
+    print_uint32_digits(n, out, digits);
+    while (chunkCount > 0) {
+        print_uint32_digits(chunks[--chunkCount], out + digits, 9);
+        digits += 9;
+    }
+    return digits;
+}
+
+int print_decimal(uint64_t value, uint8_t scale, char *out, size_t out_len) {
+    char digits[20];
+    uint8_t digitCount = print_uint64_digits(value, digits);
+    uint8_t intDigits = digitCount > scale ? digitCount - scale : 0;
+
+    // trailing zeros of the fractional part are not printed
+    uint8_t end = digitCount;
+    while (end > intDigits && digits[end - 1] == '0') {
+        end--;
+    }
+    size_t fracLen = end > intDigits ? scale - (digitCount - end) : 0;
+    size_t len = (intDigits ? intDigits : 1) + (fracLen ? 1 + fracLen : 0);
+    if (len >= out_len) {
+        return -1;
+    }
+
+    size_t i = 0;
+    if (intDigits) {
+        memcpy(out, digits, intDigits);
+        i = intDigits;
+    } else {
+        out[i++] = '0';
+    }
+    if (fracLen) {
+        out[i++] = '.';
+        memset(out + i, '0', fracLen - (end - intDigits));
+        i += fracLen - (end - intDigits);
+        memcpy(out + i, digits + intDigits, end - intDigits);
+    }
+    out[len] = '\0';
+    return len;
+}
+
 int print_amount(uint64_t amount,
                  const Asset *asset,
                  uint8_t network_id,
                  char *out,
                  size_t out_len) {
-    char buffer[AMOUNT_MAX_SIZE] = {0};
-    uint64_t dVal = amount;
-    int i;
-
-    for (i = 0; dVal > 0 || i < 9; i++) {
-        if (dVal > 0) {
-            buffer[i] = (dVal % 10) + '0';
-            dVal /= 10;
-        } else {
-            buffer[i] = '0';
+    int len = print_decimal(amount, AMOUNT_DECIMALS, out, out_len);
+    if (len < 0) {
+        return -1;
+    }
+    if (asset) {
+        // qualify amount
+        strbuf_t buf = {.ptr = out, .len = len, .size = out_len};
+        append_asset_name(asset, network_id, &buf);
+    }
+    return 0;
+}
+
+void strbuf_append_amount(strbuf_t *buf, uint64_t amount, const Asset *asset, uint8_t network_id) {
+    // the longest amount, UINT64_MAX with 7 decimals, has 21 characters
+    char decimal[24];
+    int len = print_decimal(amount, AMOUNT_DECIMALS, decimal, sizeof(decimal));
+
+    strbuf_append_n(buf, decimal, len);
+    if (asset) {
+        append_asset_name(asset, network_id, buf);
+    }
+}
+
+/* next quotient digit of a decimal long division, rem must be lower than 10 * divisor */
+static char long_division_digit(uint64_t *rem, uint64_t divisor) {
+    char digit = '0';
+    for (int shift = 3; shift >= 0; shift--) {
+        if (*rem >= divisor << shift) {
+            *rem -= divisor << shift;
+            digit += 1 << shift;
+        }
+    }
+    return digit;
+}
+
+/*
+ * Decimal long division of n by d, one digit at a time. Each digit is found with shifts and
+ * subtractions so that no 64-bit software division is needed. Digits are printed until the quotient
+ * is exact, or until at least the amount precision and significant_digits significant digits have
+ * been printed (later digits are truncated).
+ */
+static int print_price_digits(const Price *price,
+                              uint8_t significant_digits,
+                              char *out,
+                              size_t out_len) {
+    uint64_t divisors[10];
+    uint64_t rem = (uint32_t) price->n;
+    uint8_t significant = 0;
+    uint8_t decimals = 0;
+    size_t i = 0;
+    int k = 0;
+
+    if (price->d == 0 || out_len < 2) {
+        return -1;
+    }
+
+    // integer part: scale the denominator up to the most significant quotient digit
+    divisors[0] = (uint32_t) price->d;
+    while (k < 9 && (divisors[k] << 3) + (divisors[k] << 1) <= rem) {
+        divisors[k + 1] = (divisors[k] << 3) + (divisors[k] << 1);
+        k++;
+    }
+    for (; k >= 0; k--) {
+        if (i + 1 >= out_len) {
+            return -1;
         }
-        if (i == 6) {  // stroops to xlm: 1 xlm = 10000000 stroops
-            i += 1;
-            buffer[i] = '.';
+        out[i] = long_division_digit(&rem, divisors[k]);
+        if (out[i++] != '0' || significant != 0) {
+            significant++;
         }
-        if (i >= AMOUNT_MAX_SIZE) {
+    }
+
+    // fractional part
+    while (rem != 0 && (decimals < AMOUNT_DECIMALS || significant < significant_digits)) {
+        if (i + 2 >= out_len) {
             return -1;
         }
+        if (decimals == 0) {
+            out[i++] = '.';
+        }
+        rem = (rem << 3) + (rem << 1);
+        out[i] = long_division_digit(&rem, divisors[0]);
+        if (out[i++] != '0' || significant != 0) {
+            significant++;
+        }
+        decimals++;
     }
 
-    // reverse order
-    for (int j = 0; j < i / 2; j++) {
-        char c = buffer[j];
-        buffer[j] = buffer[i - j - 1];
-        buffer[i - j - 1] = c;
+    // strip trailing 0s of the truncated fractional part
+    if (decimals != 0) {
+        while (out[i - 1] == '0') {
+            i--;
+        }
+        if (out[i - 1] == '.') {
+            i--;
+        }
     }
+    out[i] = '\0';
+    return i;
+}
 
-    // strip trailing 0s
-    i -= 1;
-    while (buffer[i] == '0') {
-        buffer[i] = 0;
-        i -= 1;
+int print_price(const Price *price,
+                const Asset *asset,
+                uint8_t network_id,
+                uint8_t significant_digits,
+                char *out,
+                size_t out_len) {
+    int len = print_price_digits(price, significant_digits, out, out_len);
+    if (len < 0) {
+        return -1;
     }
-    // strip trailing .
-    if (buffer[i] == '.') buffer[i] = 0;
-    strlcpy(out, buffer, out_len);
+    if (asset) {
+        strbuf_t buf = {.ptr = out, .len = len, .size = out_len};
+        append_asset_name(asset, network_id, &buf);
+    }
+    return 0;
+}
 
+int strbuf_append_price(strbuf_t *buf,
+                        const Price *price,
+                        const Asset *asset,
+                        uint8_t network_id,
+                        uint8_t significant_digits) {
+    // 10 integer digits, the point, up to 9 leading zeros and the significant digits
+    char digits[32];
+    int len = print_price_digits(price, significant_digits, digits, sizeof(digits));
+    if (len < 0) {
+        return -1;
+    }
+    strbuf_append_n(buf, digits, len);
     if (asset) {
-        // qualify amount
-        print_asset_name(asset, network_id, buffer, AMOUNT_MAX_SIZE);
-        strlcat(out, " ", out_len);
-        strlcat(out, buffer, out_len);
+        append_asset_name(asset, network_id, buf);
     }
     return 0;
 }
@@ -313,81 +827,88 @@ int print_int(int64_t l, char *out, size_t out_len) {
     }
     if (l < 0) {
         out[0] = '-';
-        return print_uint(-l, out + 1, out_len - 1);
+        return print_uint(-(uint64_t) l, out + 1, out_len - 1);
     }
     return print_uint(l, out, out_len);
 }
 
 int print_uint(uint64_t l, char *out, size_t out_len) {
-    char buffer[AMOUNT_MAX_SIZE];
-    uint64_t dVal = l;
-    size_t i, j;
+    char buffer[20];
+    uint8_t digits = print_uint64_digits(l, buffer);
 
-    if (l == 0) {
-        if (out_len < 2) {
-            return -1;
-        }
-        strlcpy(out, "0", out_len);
-        return 0;
-    }
-
-    memset(buffer, 0, AMOUNT_MAX_SIZE);
-    for (i = 0; dVal > 0; i++) {
-        if (i >= AMOUNT_MAX_SIZE) {
-            return -1;
-        }
-        buffer[i] = (dVal % 10) + '0';
-        dVal /= 10;
-    }
-    if (out_len <= i) {
+    if (out_len <= digits) {
         return -1;
     }
-    // reverse order
-    for (j = 0; j < i; j++) {
-        out[j] = buffer[i - j - 1];
-    }
-    out[i] = '\0';
+    memcpy(out, buffer, digits);
+    out[digits] = '\0';
     return 0;
 }
 
-void print_asset_t(const Asset *asset, uint8_t network_id, char *out, size_t out_len) {
+void strbuf_append_int(strbuf_t *buf, int64_t l) {
+    if (l < 0) {
+        strbuf_append(buf, "-");
+        strbuf_append_uint(buf, -(uint64_t) l);
+    } else {
+        strbuf_append_uint(buf, l);
+    }
+}
+
+void strbuf_append_uint(strbuf_t *buf, uint64_t l) {
+    char digits[20];
+    strbuf_append_n(buf, digits, print_uint64_digits(l, digits));
+}
+
+void print_asset_t(const Asset *asset, uint8_t network_id, strbuf_t *out) {
     char issuer[12];
-    char asset_name[12 + 1];
 
-    print_asset_name(asset, network_id, asset_name, sizeof(asset_name));
     print_public_key(asset->issuer, issuer, 3, 4);
-    print_asset(asset_name, issuer, out, out_len);
+    if (print_asset_name(asset, network_id, out) == 0) {
+        strbuf_append(out, "@");
+        strbuf_append(out, issuer);
+    }
 }
 
-void print_asset(const char *code, char *issuer, char *out, size_t out_len) {
-    strlcpy(out, code, out_len);
-    strlcat(out, "@", out_len);
-    strlcat(out, issuer, out_len);
+void print_asset(const char *code, const char *issuer, strbuf_t *out) {
+    strbuf_append(out, code);
+    strbuf_append(out, "@");
+    strbuf_append(out, issuer);
 }
 
-static void print_flag(char *flag, char *out, size_t out_len) {
-    if (out[0]) {
-        strlcat(out, ", ", out_len);
+static void print_flag(const char *flag, strbuf_t *out) {
+    if (out->len != 0) {
+        strbuf_append(out, ", ");
     }
-    strlcat(out, flag, out_len);
+    strbuf_append(out, flag);
 }
 
-void print_flags(uint32_t flags, char *out, size_t out_len) {
+void print_flags(uint32_t flags, strbuf_t *out) {
     if (flags & 0x01u) {
-        print_flag("Auth required", out, out_len);
+        print_flag("Auth required", out);
     }
     if (flags & 0x02u) {
-        print_flag("Auth revocable", out, out_len);
+        print_flag("Auth revocable", out);
     }
     if (flags & 0x04u) {
-        print_flag("Auth immutable", out, out_len);
+        print_flag("Auth immutable", out);
+    }
+}
+
+void print_bip32_path(const uint32_t *path, uint8_t pathLen, strbuf_t *out) {
+    for (uint8_t i = 0; i < pathLen; i++) {
+        if (i != 0) {
+            strbuf_append(out, "/");
+        }
+        strbuf_append_uint(out, path[i] & 0x7fffffffu);
+        if (path[i] & 0x80000000u) {
+            strbuf_append(out, "'");
+        }
     }
 }
 
-void print_native_asset_code(uint8_t network, char *out, size_t out_len) {
+void print_native_asset_code(uint8_t network, strbuf_t *out) {
     if (network == NETWORK_TYPE_UNKNOWN) {
-        strlcpy(out, "native", out_len);
+        strbuf_append(out, "native");
     } else {
-        strlcpy(out, "XLM", out_len);
+        strbuf_append(out, "XLM");
     }
 }
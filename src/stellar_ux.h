@@ -20,7 +20,6 @@
 
 #include "stellar_types.h"
 
-#ifndef TEST
 #include "ux.h"
 // ------------------------------------------------------------------------- //
 //                     Implemented by stellar_ux_common.c                    //
@@ -35,7 +34,6 @@ unsigned int io_seproxyhal_touch_address_cancel(const bagl_element_t *e);
 // ------------------------------------------------------------------------- //
 //        Implemented by stellar_ux_nanox.c                                  //
 // ------------------------------------------------------------------------- //
-#endif
 
 void ui_show_address_init(void);
 void ui_approve_tx_init(void);
@@ -44,12 +44,45 @@ unsigned int io_seproxyhal_touch_address_cancel(const bagl_element_t *e) {
 
 unsigned int io_seproxyhal_touch_tx_ok(const bagl_element_t *e) {
     (void) e;
-    ctx.state = STATE_NONE;
+#ifdef HAVE_TX_QUEUE
+    if (ctx.req.tx.queued) {
+        // the host polls for the signature, there is no command to reply to
+        queue_review_done(true);
+        return 0;
+    }
+#endif
+    int error;
+    if (ctx.state == STATE_APPROVE_TX_HASHES) {
+        ctx.state = STATE_SEND_SIGNATURES;
+        error = sign_next_hashes();
+    } else if (ctx.state == STATE_APPROVE_TX || ctx.state == STATE_APPROVE_TX_HASH) {
+        ctx.state = STATE_NONE;
+        error = sign_tx_hash(G_io_apdu_buffer);
+    } else {
+        // a later request replaced the one on screen, or it was already answered
+        clear_signing_key();
+        error = 0x6985;
+    }
+    if (error) {
+        explicit_bzero(G_io_apdu_buffer, sizeof(G_io_apdu_buffer));
+        if ((error & 0xF000) != 0x6000) {
+            error = 0x6800 | (error & 0x7FF);
+        }
+        return io_seproxyhal_respond(error, 0);
+    }
     return io_seproxyhal_respond(0x9000, ctx.req.tx.tx);
 }
 
 unsigned int io_seproxyhal_touch_tx_cancel(const bagl_element_t *e) {
     (void) e;
+#ifdef HAVE_TX_QUEUE
+    if (ctx.req.tx.queued) {
+        queue_review_done(false);
+        return 0;
+    }
+#endif
+    ctx.state = STATE_NONE;
+    clear_signing_key();
     explicit_bzero(G_io_apdu_buffer, sizeof(G_io_apdu_buffer));
     return io_seproxyhal_respond(0x6985, 0);
 }
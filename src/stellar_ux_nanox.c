@@ -13,6 +13,9 @@ ux_state_t G_ux;
 bolos_ux_params_t G_ux_params;
 
 void settings_hash_signing_change(unsigned int enabled);
+#ifdef HAVE_KEY_CACHES
+void settings_key_caching_change(unsigned int enabled);
+#endif
 const char* settings_submenu_getter(unsigned int idx);
 void settings_submenu_selector(unsigned int idx);
 
@@ -60,15 +63,70 @@ void settings_hash_signing(void) {
 }
 
 void settings_hash_signing_change(unsigned int enabled) {
-    nvm_write((void*) &N_stellar_pstate.hashSigning, &enabled, 1);
+    nv_write(&N_stellar_pstate.hashSigning, &enabled, 1);
+    nv_commit();
+    ui_idle();
+}
+
+#ifdef HAVE_KEY_CACHES
+//////////////////////////////////////////////////////////////////////////////////////
+// clang-format off
+UX_STEP_CB(
+  settings_key_caching_enable_step,
+  pbb,
+  settings_key_caching_change(1),
+  {
+    &C_icon_validate_14,
+    "Remember public",
+    "keys?",
+  });
+UX_STEP_CB(
+  settings_key_caching_disable_step,
+  pb,
+  settings_key_caching_change(0),
+  {
+    &C_icon_crossmark,
+    "Disable",
+  });
+UX_STEP_CB(
+  settings_key_caching_go_back_step,
+  pb,
+  ux_menulist_init(0, settings_submenu_getter, settings_submenu_selector),
+  {
+    &C_icon_back_x,
+    "Back",
+  });
+
+UX_DEF(settings_key_caching_flow,
+  &settings_key_caching_enable_step,
+  &settings_key_caching_disable_step,
+  &settings_key_caching_go_back_step
+);
+// clang-format on
+
+void settings_key_caching(void) {
+    ux_flow_init(0, settings_key_caching_flow, NULL);
+}
+
+void settings_key_caching_change(unsigned int enabled) {
+    nv_write(&N_stellar_pstate.pubkeyCaching, &enabled, 1);
+    if (!enabled) {
+        // forget the paths that were used, in the same commit
+        nv_pubkey_cache_clear();
+    }
+    nv_commit();
     ui_idle();
 }
+#endif
 
 //////////////////////////////////////////////////////////////////////////////////////
 // Settings menu:
 
 const char* const settings_submenu_getter_values[] = {
     "Hash signing",
+#ifdef HAVE_KEY_CACHES
+    "Key caching",
+#endif
     "Back",
 };
 
@@ -84,6 +142,11 @@ void settings_submenu_selector(unsigned int idx) {
         case 0:
             settings_hash_signing();
             break;
+#ifdef HAVE_KEY_CACHES
+        case 1:
+            settings_key_caching();
+            break;
+#endif
         default:
             ui_idle();
     }
@@ -203,6 +266,19 @@ void ui_show_address_init(void) {
 
 void display_next_state(bool is_upper_border);
 
+/*
+ * "nnn screens", shown on the first step so the length of the review is known upfront. The
+ * detail steps do not show their position: their title line holds the caption, to which
+ * bnnn_paging already appends its own page counter, and a "screen i of N" counter next to a
+ * caption such as "Medium Threshold" would not fit on the line.
+ */
+char screenCountCaption[12];
+
+static void set_screen_count_caption(uint16_t count) {
+    print_uint(count, screenCountCaption, sizeof(screenCountCaption));
+    strlcat(screenCountCaption, " screens", sizeof(screenCountCaption));
+}
+
 // clang-format off
 UX_STEP_NOCB(
     ux_confirm_tx_init_flow_step, 
@@ -210,7 +286,7 @@ UX_STEP_NOCB(
     {
       &C_icon_eye,
       "Review",
-      "Transaction",
+      screenCountCaption,
     });
 
 UX_STEP_INIT(
@@ -330,6 +406,12 @@ void ui_approve_tx_init(void) {
     num_data = ctx.req.tx.opCount;
     current_data_index = 0;
     current_state = OUT_OF_BORDERS;
+    uint16_t screen_count;
+    if (get_transaction_screen_count(&ctx.req.tx, &screen_count)) {
+        set_screen_count_caption(screen_count);
+    } else {
+        strlcpy(screenCountCaption, "Transaction", sizeof(screenCountCaption));
+    }
     ux_flow_init(0, ux_confirm_flow, NULL);
 }
 
@@ -339,6 +421,7 @@ void ui_approve_tx_hash_init(void) {
     num_data = ctx.req.tx.opCount;
     current_data_index = 0;
     current_state = OUT_OF_BORDERS;
+    set_screen_count_caption(ctx.req.tx.hashCount ? TX_HASHES_SCREEN_COUNT : TX_HASH_SCREEN_COUNT);
     ux_flow_init(0, ux_confirm_flow, NULL);
 }
 
@@ -18,7 +18,7 @@
 #ifndef STELLAR_VARS_H
 #define STELLAR_VARS_H
 
-#ifndef TEST
+#if !defined(TEST) && !defined(SOFTSIGN)
 #include "os.h"
 #include "ux.h"
 
@@ -27,11 +27,19 @@ extern ux_state_t ux;
 
 #include "stellar_types.h"
 
-extern stellar_context_t ctx;
+extern APP_THREAD_LOCAL stellar_context_t ctx;
 extern bool called_from_swap;
 extern swap_values_t swap_values;
-extern stellar_nv_state_t const N_state_pic;
-#define N_stellar_pstate (*(volatile stellar_nv_state_t *) PIC(&N_state_pic))
+#ifdef TEST
+extern stellar_nv_store_t N_state_pic;  // nvm_write() writes it in place on the host
+#else
+extern stellar_nv_store_t const N_state_pic;
+#endif
+#define N_stellar_pstore (*(volatile stellar_nv_store_t *) PIC(&N_state_pic))
+
+/* the persistent state is read from a RAM shadow, changed with nv_write() and nv_commit() */
+extern nv_snapshot_t nv_shadow;
+#define N_stellar_pstate (nv_shadow.state)
 
 void reset_ctx();
 
@@ -14,6 +14,12 @@ int handle_check_address(const check_address_parameters_t* params) {
         return 0;
     }
 
+    uint8_t expected_publicKey[32];
+    if (!decode_strkey(params->address_to_check, STRKEY_VERSION_ACCOUNT_ID, expected_publicKey)) {
+        PRINTF("Invalid address\n");
+        return 0;
+    }
+
     uint32_t bip32_path[MAX_BIP32_LEN];
     uint8_t bip32_path_length = *params->address_parameters;
     if (!parse_bip32_path(params->address_parameters + 1,
@@ -24,26 +30,13 @@ int handle_check_address(const check_address_parameters_t* params) {
         return 0;
     }
 
-    cx_ecfp_private_key_t privateKey;
-    cx_ecfp_public_key_t publicKey;
     uint8_t stellar_publicKey[32];
-    int error = derive_private_key(&privateKey, bip32_path, bip32_path_length);
-    if (error) {
-        explicit_bzero(&privateKey, sizeof(privateKey));
-        PRINTF("derive_private_key failed\n");
+    if (derive_public_key(bip32_path, bip32_path_length, stellar_publicKey, false) != 0) {
+        PRINTF("derive_public_key failed\n");
         return 0;
     }
-    error = init_public_key(&privateKey, &publicKey, stellar_publicKey);
-    explicit_bzero(&privateKey, sizeof(privateKey));
-    if (error) {
-        PRINTF("init_public_key failed\n");
-        return 0;
-    }
-
-    char address[57];
-    encode_public_key(stellar_publicKey, address);
 
-    if (strcmp(address, params->address_to_check) != 0) {
+    if (memcmp(stellar_publicKey, expected_publicKey, sizeof(stellar_publicKey)) != 0) {
         PRINTF("Addresses do not match\n");
         return 0;
     }
@@ -2,6 +2,7 @@
 #include "swap_lib_calls.h"
 #include "ux.h"
 #include "stellar_vars.h"
+#include "stellar_api.h"
 
 bool copy_transaction_parameters(const create_transaction_parameters_t* params) {
     // first copy parameters to stack, and then to global data.
@@ -9,11 +10,14 @@ bool copy_transaction_parameters(const create_transaction_parameters_t* params)
     swap_values_t stack_data;
     memset(&stack_data, 0, sizeof(stack_data));
 
-    if (strlen(params->destination_address) >= sizeof(stack_data.destination) ||
-        strlen(params->destination_address_extra_id) >= sizeof(stack_data.memo)) {
+    if (strlen(params->destination_address_extra_id) >= sizeof(stack_data.memo)) {
+        return false;
+    }
+    if (!decode_strkey(params->destination_address,
+                       STRKEY_VERSION_ACCOUNT_ID,
+                       stack_data.destination)) {
         return false;
     }
-    strlcpy(stack_data.destination, params->destination_address, sizeof(stack_data.destination));
     strlcpy(stack_data.memo, params->destination_address_extra_id, sizeof(stack_data.memo));
 
     if (!swap_str_to_u64(params->amount, params->amount_length, &stack_data.amount)) {
@@ -1,56 +1,62 @@
+#include "os.h"
+
 #include "stellar_vars.h"
 #include "stellar_ux.h"
 #include "stellar_api.h"
 #include "stellar_format.h"
 
-void swap_check() {
-    char *tmp_buf = detailValue;
-
-    tx_context_t *txCtx = &ctx.req.tx;
-
+static bool swap_tx_matches(const tx_context_t *txCtx) {
     // A XLM swap consist of only one "send" operation
     if (txCtx->opCount > 1) {
-        io_seproxyhal_touch_tx_cancel(NULL);
+        return false;
     }
 
     // tx type
     if (txCtx->opDetails.type != XDR_OPERATION_TYPE_PAYMENT) {
-        io_seproxyhal_touch_tx_cancel(NULL);
+        return false;
     }
 
     // amount
     if (txCtx->opDetails.payment.asset.type != ASSET_TYPE_NATIVE ||
         txCtx->opDetails.payment.amount != (int64_t) swap_values.amount) {
-        io_seproxyhal_touch_tx_cancel(NULL);
+        return false;
     }
 
     // destination addr
-    print_public_key(txCtx->opDetails.payment.destination, tmp_buf, 0, 0);
-    if (strcmp(tmp_buf, swap_values.destination) != 0) {
-        io_seproxyhal_touch_tx_cancel(NULL);
+    if (memcmp(txCtx->opDetails.payment.destination, swap_values.destination, 32) != 0) {
+        return false;
     }
 
     if (txCtx->opDetails.sourceAccountPresent) {
-        io_seproxyhal_touch_tx_cancel(NULL);
+        return false;
     }
 
     // memo
     if (txCtx->txDetails.memo.type != MEMO_TEXT ||
         strcmp(txCtx->txDetails.memo.text, swap_values.memo) != 0) {
-        io_seproxyhal_touch_tx_cancel(NULL);
+        return false;
     }
 
     // fees
     if (txCtx->network != NETWORK_TYPE_PUBLIC || txCtx->txDetails.fee != swap_values.fees) {
-        io_seproxyhal_touch_tx_cancel(NULL);
+        return false;
     }
 
     if (txCtx->txDetails.hasTimeBounds) {
-        io_seproxyhal_touch_tx_cancel(NULL);
+        return false;
     }
 
     // // we don't do any check on "TX Source" field
     // // If we've reached this point without failure, we're good to go !
+    return true;
+}
+
+void swap_check() {
+    if (!swap_tx_matches(&ctx.req.tx)) {
+        // the transaction is never signed, the caller exits the app
+        io_seproxyhal_touch_tx_cancel(NULL);
+        return;
+    }
     io_seproxyhal_touch_tx_ok(NULL);
     os_sched_exit(0);
 }
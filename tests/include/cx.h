@@ -107,4 +107,37 @@ struct cx_ecfp_256_private_key_s {
     /** Public key value starting at offset 0 */
     unsigned char d[32];
 };
-typedef struct cx_ecfp_256_private_key_s cx_ecfp_private_key_t;
\ No newline at end of file
+typedef struct cx_ecfp_256_private_key_s cx_ecfp_private_key_t;
+
+int cx_hash_sha256(const unsigned char *in,
+                   unsigned int len,
+                   unsigned char *out,
+                   unsigned int out_len);
+
+int cx_hmac_sha256(const unsigned char *key,
+                   unsigned int key_len,
+                   const unsigned char *in,
+                   unsigned int len,
+                   unsigned char *mac,
+                   unsigned int mac_len);
+
+int cx_ecfp_init_private_key(cx_curve_t curve,
+                             const unsigned char *rawkey,
+                             unsigned int key_len,
+                             cx_ecfp_private_key_t *pvkey);
+
+int cx_ecfp_generate_pair(cx_curve_t curve,
+                          cx_ecfp_public_key_t *pubkey,
+                          cx_ecfp_private_key_t *privkey,
+                          int keepprivate);
+
+int cx_eddsa_sign(const cx_ecfp_private_key_t *pvkey,
+                  int mode,
+                  cx_md_t hashID,
+                  const unsigned char *hash,
+                  unsigned int hash_len,
+                  const unsigned char *ctx,
+                  unsigned int ctx_len,
+                  unsigned char *sig,
+                  unsigned int sig_len,
+                  unsigned int *info);
@@ -2,6 +2,8 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <setjmp.h>
 
 #define EXCEPTION             1
 #define INVALID_PARAMETER     2
@@ -25,3 +27,73 @@
 
 #define MAX(a, b) ((a) > (b)) ? (a) : (b)
 #define MIN(a, b) ((a) < (b)) ? (a) : (b)
+
+#define U4BE(buf, off)                                                       \
+    ((((uint32_t) (buf)[off]) << 24) | (((uint32_t) (buf)[(off) + 1]) << 16) | \
+     (((uint32_t) (buf)[(off) + 2]) << 8) | ((uint32_t) (buf)[(off) + 3]))
+
+#define IO_ASYNCH_REPLY 0x10
+
+/* Exceptions, implemented with setjmp/longjmp like the SDK */
+typedef unsigned short exception_t;
+
+typedef struct try_context_s {
+    jmp_buf jmp_buf;
+    struct try_context_s *previous;
+    exception_t ex;
+} try_context_t;
+
+extern try_context_t *G_try_last_open_context;
+
+void os_longjmp(unsigned int exception);
+
+#define THROW(x) os_longjmp(x)
+
+#define BEGIN_TRY                    \
+    {                                \
+        try_context_t __try_context; \
+        __try_context.previous = G_try_last_open_context;
+
+#define TRY                                                             \
+    __try_context.ex = (exception_t) setjmp(__try_context.jmp_buf);     \
+    G_try_last_open_context = &__try_context;                           \
+    if (__try_context.ex == 0) {
+#define CATCH(x)                                          \
+    }                                                     \
+    else if (__try_context.ex == (x)) {                   \
+        __try_context.ex = 0;                             \
+        G_try_last_open_context = __try_context.previous;
+
+#define CATCH_OTHER(e)                                    \
+    }                                                     \
+    else {                                                \
+        exception_t e = __try_context.ex;                 \
+        __try_context.ex = 0;                             \
+        G_try_last_open_context = __try_context.previous;
+
+#define FINALLY                                       \
+    }                                                 \
+    G_try_last_open_context = __try_context.previous; \
+    {
+#define END_TRY                          \
+    }                                    \
+    if (__try_context.ex != 0) {         \
+        THROW(__try_context.ex);         \
+    }                                    \
+    }
+
+/* SLIP-10 derivation, from the seed of the speculos default mnemonic */
+#define HDW_ED25519_SLIP10 1
+
+void os_perso_derive_node_bip32_seed_key(unsigned int mode,
+                                         unsigned int curve,
+                                         const unsigned int *path,
+                                         unsigned int pathLength,
+                                         unsigned char *privateKey,
+                                         unsigned char *chain,
+                                         unsigned char *seed_key,
+                                         unsigned int seed_key_length);
+
+void os_sched_exit(int exit_code);
+
+void nvm_write(void *dst_adr, void *src_adr, unsigned int src_len);
@@ -4,4 +4,19 @@
  * Function to ensure a I/O channel is not timeouting waiting for operations
  * after a long time without SEPH packet exchanges
  */
-void io_seproxyhal_io_heartbeat(void);
\ No newline at end of file
+void io_seproxyhal_io_heartbeat(void);
+
+#define IO_APDU_BUFFER_SIZE 260
+
+#define IO_SEPROXYHAL_BUFFER_SIZE_B 128
+
+extern unsigned char G_io_apdu_buffer[IO_APDU_BUFFER_SIZE];
+
+#define CHANNEL_APDU       0
+#define IO_RETURN_AFTER_TX 0x20
+
+/**
+ * Send tx_len bytes of G_io_apdu_buffer, then receive the next command unless IO_RETURN_AFTER_TX
+ * is set. Returns the length of the command received.
+ */
+unsigned short io_exchange(unsigned char channel_and_flags, unsigned short tx_len);
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "os_io_seproxyhal.h"
+
+/* the host build draws nothing, the UX callbacks are called by the tests */
+typedef struct bagl_element_e bagl_element_t;
+
+typedef struct {
+    unsigned int stack_count;
+} ux_state_t;
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+static inline uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+/* time stamp counter ticks, nanoseconds where there is none */
+static inline uint64_t bench_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return bench_now_ns();
+#endif
+}
+
+/* prevent the compiler from optimizing away the benchmarked computation */
+static inline void bench_clobber(const void *p) {
+    __asm__ volatile("" : : "g"(p) : "memory");
+}
+
+/* runs stmt iterations times and prints the average time per iteration */
+#define BENCH(name, iterations, stmt)                                       \
+    do {                                                                    \
+        uint64_t _start = bench_now_ns();                                   \
+        for (uint64_t _i = 0; _i < (iterations); _i++) {                    \
+            stmt;                                                           \
+        }                                                                   \
+        uint64_t _elapsed = bench_now_ns() - _start;                        \
+        printf("%-40s %10.1f ns/op\n", name, (double) _elapsed / (iterations)); \
+    } while (0)
@@ -0,0 +1,42 @@
+#include <stdlib.h>
+
+#include "bench.h"
+#include "stellar_api.h"
+#include "reference.h"
+
+#define ROUNDS 20000
+
+typedef uint16_t (*crc16_function_t)(const uint8_t *data, size_t length);
+
+static void bench_crc16(const char *name,
+                        crc16_function_t crc,
+                        const uint8_t *data,
+                        size_t length) {
+    volatile uint16_t sink = 0;
+    uint64_t start = bench_cycles();
+    for (int i = 0; i < ROUNDS; i++) {
+        sink ^= crc(data, length);
+    }
+    uint64_t elapsed = bench_cycles() - start;
+    printf("%-20s %5zu bytes %8.2f cycles/byte\n",
+           name,
+           length,
+           (double) elapsed / ((double) ROUNDS * length));
+}
+
+int main() {
+    static uint8_t data[4096];
+    const size_t lengths[] = {STRKEY_RAW_SIZE - 2, sizeof(data)};
+
+    srand(0);
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = rand();
+    }
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        bench_crc16("bitwise", crc16_bitwise, data, lengths[i]);
+        bench_crc16("crc16_nibble", crc16_nibble, data, lengths[i]);
+        bench_crc16("crc16_byte", crc16_byte, data, lengths[i]);
+        bench_crc16("crc16_slice4", crc16_slice4, data, lengths[i]);
+    }
+    return 0;
+}
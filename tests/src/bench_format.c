@@ -0,0 +1,94 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "stellar_api.h"
+#include "stellar_format.h"
+
+stellar_context_t ctx;
+
+/* SHA256("Public Global Stellar Network ; September 2015") */
+static const uint8_t public_network_id[32] = {
+    0x7a, 0xc3, 0x39, 0x97, 0x54, 0x4e, 0x31, 0x75, 0xd2, 0x66, 0xbd, 0x02, 0x24, 0x39, 0xb2, 0x2c,
+    0xdb, 0x16, 0x50, 0x8c, 0x01, 0x16, 0x3f, 0x26, 0xe5, 0xcb, 0x2a, 0x3e, 0x10, 0x45, 0xa9, 0x79};
+
+static uint8_t *write32(uint8_t *p, uint32_t n) {
+    p[0] = n >> 24;
+    p[1] = n >> 16;
+    p[2] = n >> 8;
+    p[3] = n;
+    return p + 4;
+}
+
+static uint8_t *write64(uint8_t *p, uint64_t n) {
+    p = write32(p, n >> 32);
+    return write32(p, n);
+}
+
+/* MAX_OPS bump sequence operations with time bounds: the largest operation count that fits */
+static void build_max_ops_envelope(tx_context_t *txCtx) {
+    uint8_t *p = txCtx->raw;
+
+    memcpy(p, public_network_id, 32);
+    p += 32;
+    p = write32(p, 2);  // ENVELOPE_TYPE_TX
+    p = write32(p, PUBLIC_KEY_TYPE_ED25519);
+    memset(p, 0x42, 32);
+    p += 32;
+    p = write32(p, 100 * MAX_OPS);  // fee
+    p = write64(p, 1234567890);     // sequence number
+    p = write32(p, 1);              // time bounds present
+    p = write64(p, 1500000000);
+    p = write64(p, 1600000000);
+    p = write32(p, MEMO_NONE);
+    p = write32(p, MAX_OPS);
+    for (int i = 0; i < MAX_OPS; i++) {
+        p = write32(p, 0);  // no operation source
+        p = write32(p, XDR_OPERATION_TYPE_BUMP_SEQUENCE);
+        p = write64(p, 1234567890 + i);
+    }
+    txCtx->rawLength = p - txCtx->raw;
+}
+
+static uint16_t render_all_screens(tx_context_t *txCtx) {
+    uint16_t screens = 0;
+
+    txCtx->offset = 0;
+    parse_tx_xdr(txCtx->raw, txCtx->rawLength, txCtx);
+    formatter_index = 0;
+    memset(formatter_stack, 0, sizeof(formatter_stack));
+    current_data_index = 0;
+
+    set_state_data(true);
+    while ((current_data_index < txCtx->opCount) || formatter_stack[formatter_index] != NULL) {
+        bench_clobber(detailValue);
+        screens++;
+        formatter_index++;
+        if (formatter_stack[formatter_index] != NULL) {
+            set_state_data(true);
+        }
+    }
+    return screens;
+}
+
+int main() {
+    const int iterations = 20000;
+    uint16_t count;
+
+    build_max_ops_envelope(&ctx.req.tx);
+    ctx.state = STATE_APPROVE_TX;
+
+    if (!get_transaction_screen_count(&ctx.req.tx, &count) ||
+        count != render_all_screens(&ctx.req.tx)) {
+        fprintf(stderr, "screen count mismatch\n");
+        return 1;
+    }
+    printf("%d operations, %u screens, %u bytes\n", MAX_OPS, count, ctx.req.tx.rawLength);
+
+    BENCH("get_transaction_screen_count", iterations, {
+        get_transaction_screen_count(&ctx.req.tx, &count);
+        bench_clobber(&count);
+    });
+    BENCH("render all screens", iterations, render_all_screens(&ctx.req.tx));
+    return 0;
+}
@@ -0,0 +1,211 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "stellar_api.h"
+#include "reference.h"
+
+#define SAMPLES 1024
+
+/*
+ * Cortex-M0 cost model (no hardware divider, no 32x32->64 multiply instruction), in cycles:
+ * libgcc 64-bit division, 64-bit compare-and-subtract, 64-bit multiplication by 10 (shift-add)
+ * and libgcc 64-bit multiplication.
+ */
+#define CM0_ULDIVMOD 300
+#define CM0_SUB64    6
+#define CM0_MUL10    10
+#define CM0_LMUL     40
+
+static Price prices[SAMPLES];
+
+/* former formatting: one 64-by-32 division, then two 64-bit divisions per printed digit */
+static void print_price_fixed_point(const Price *price, char *out, size_t out_len) {
+    uint64_t fixed = ((uint64_t) price->n * 10000000) / price->d;
+    print_amount(fixed, NULL, NETWORK_TYPE_PUBLIC, out, out_len);
+}
+
+static unsigned long cm0_cost_fixed_point(const char *printed) {
+    size_t digits = 0;
+    for (const char *c = printed; *c; c++) {
+        digits += *c != '.';
+    }
+    // print_amount produces at least 9 digits before stripping zeros
+    return CM0_ULDIVMOD + 2 * CM0_ULDIVMOD * (digits < 9 ? 9 : digits);
+}
+
+/* print_uint_divide: a quotient and a remainder per digit */
+static unsigned long cm0_cost_uint_divide(size_t digits) {
+    return 2 * CM0_ULDIVMOD * digits;
+}
+
+/* print_uint: one division per 9 digits above the lowest 9, one multiplication per 2 digits */
+static unsigned long cm0_cost_uint_chunked(size_t digits) {
+    return CM0_ULDIVMOD * ((digits - 1) / 9) + CM0_LMUL * (digits / 2);
+}
+
+/* print_price: one shift-add to scale the divisor and four compare-and-subtract per digit */
+static unsigned long cm0_cost_long_division(const char *printed) {
+    unsigned long cost = 0;
+    for (const char *c = printed; *c; c++) {
+        if (*c != '.') {
+            cost += CM0_MUL10 + 4 * CM0_SUB64;
+        }
+    }
+    return cost;
+}
+
+int main() {
+    char out[32];
+    unsigned long fixed_cycles = 0, division_cycles = 0;
+
+    srand(0);
+    for (int i = 0; i < SAMPLES; i++) {
+        prices[i].n = rand() >> (rand() % 31);
+        prices[i].d = (rand() >> (rand() % 31)) + 1;
+
+        print_price_fixed_point(&prices[i], out, sizeof(out));
+        fixed_cycles += cm0_cost_fixed_point(out);
+        print_price(&prices[i], NULL, NETWORK_TYPE_PUBLIC, PRICE_SIGNIFICANT_DIGITS, out, 32);
+        division_cycles += cm0_cost_long_division(out);
+    }
+
+    BENCH("price: uint64 division + print_amount", SAMPLES * 100, {
+        print_price_fixed_point(&prices[_i % SAMPLES], out, sizeof(out));
+        bench_clobber(out);
+    });
+    BENCH("price: print_price", SAMPLES * 100, {
+        print_price(&prices[_i % SAMPLES],
+                    NULL,
+                    NETWORK_TYPE_PUBLIC,
+                    PRICE_SIGNIFICANT_DIGITS,
+                    out,
+                    sizeof(out));
+        bench_clobber(out);
+    });
+    uint8_t key[32];
+    for (int i = 0; i < 32; i++) {
+        key[i] = rand();
+    }
+    unsigned long uint_divide_cycles = 0, uint_chunked_cycles = 0;
+    for (int i = 0; i < SAMPLES; i++) {
+        print_uint((uint64_t) rand() << 33 ^ (uint64_t) rand() << 2 ^ rand(), out, sizeof(out));
+        uint_divide_cycles += cm0_cost_uint_divide(strlen(out));
+        uint_chunked_cycles += cm0_cost_uint_chunked(strlen(out));
+    }
+
+    BENCH("uint: 64-bit division", 1000000, {
+        print_uint_divide(UINT64_MAX - _i, out, sizeof(out));
+        bench_clobber(out);
+    });
+    BENCH("uint: print_uint", 1000000, {
+        print_uint(UINT64_MAX - _i, out, sizeof(out));
+        bench_clobber(out);
+    });
+    uint8_t data[64];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = rand();
+    }
+    BENCH("data value: base64 reference", 1000000, {
+        char full[89];
+        data[0] = _i;
+        base64_encode_reference(data, sizeof(data), full);
+        bench_clobber(full);
+    });
+    BENCH("data value: base64_encode", 1000000, {
+        char full[89];
+        data[0] = _i;
+        base64_encode(data, sizeof(data), full);
+        bench_clobber(full);
+    });
+    BENCH("data value: base64_encode + print_summary", 1000000, {
+        char full[89];
+        data[0] = _i;
+        base64_encode(data, sizeof(data), full);
+        print_summary(full, out, 12, 12);
+        bench_clobber(out);
+    });
+    BENCH("data value: print_base64_summary", 1000000, {
+        data[0] = _i;
+        print_base64_summary(data, sizeof(data), out, 12, 12);
+        bench_clobber(out);
+    });
+    uint8_t hash[32];
+    for (size_t i = 0; i < sizeof(hash); i++) {
+        hash[i] = rand();
+    }
+    BENCH("hash: division hex", 1000000, {
+        char hex[67];
+        hash[0] = _i;
+        print_binary_reference(hash, hex, sizeof(hash));
+        bench_clobber(hex);
+    });
+    BENCH("hash: print_binary", 1000000, {
+        char hex[67];
+        hash[0] = _i;
+        print_binary(hash, hex, sizeof(hash));
+        bench_clobber(hex);
+    });
+    BENCH("hash summary: print_binary_summary", 1000000, {
+        hash[0] = _i;
+        print_binary_summary(hash, out, sizeof(hash));
+        bench_clobber(out);
+    });
+
+    // batch tools dump many hashes at once
+    static uint8_t hashes[1 << 20];
+    static char dump[2 * sizeof(hashes) + 1];
+    for (size_t i = 0; i < sizeof(hashes); i++) {
+        hashes[i] = rand();
+    }
+    BENCH("1 MiB: print_hex", 100, {
+        hashes[0] = _i;
+        print_hex(hashes, sizeof(hashes), dump);
+        bench_clobber(dump);
+    });
+#ifdef HAVE_HOST_SIMD
+    BENCH("1 MiB: print_hex_ssse3", 100, {
+        hashes[0] = _i;
+        print_hex_ssse3(hashes, sizeof(hashes), dump);
+        bench_clobber(dump);
+    });
+#endif
+    BENCH("strkey: generic base32_encode", 1000000, {
+        uint8_t raw[STRKEY_RAW_SIZE];
+        char full[57];
+        raw[0] = STRKEY_VERSION_ACCOUNT_ID;
+        memcpy(raw + 1, key, 32);
+        raw[1] = _i;
+        uint16_t crc = crc16(raw, 33);
+        raw[33] = crc;
+        raw[34] = crc >> 8;
+        base32_encode(raw, STRKEY_RAW_SIZE, full, sizeof(full));
+        bench_clobber(full);
+    });
+    BENCH("strkey: encode_public_key", 1000000, {
+        char full[57];
+        key[0] = _i;
+        encode_public_key(key, full);
+        bench_clobber(full);
+    });
+    BENCH("issuer: encode_public_key + print_summary", 1000000, {
+        char full[57];
+        key[0] = _i;
+        encode_public_key(key, full);
+        print_summary(full, out, 3, 4);
+        bench_clobber(out);
+    });
+    BENCH("issuer: print_public_key", 1000000, {
+        key[0] = _i;
+        print_public_key(key, out, 3, 4);
+        bench_clobber(out);
+    });
+
+    printf("%-40s %10lu cycles/op\n", "cortex-m0 model: fixed point", fixed_cycles / SAMPLES);
+    printf("%-40s %10lu cycles/op\n", "cortex-m0 model: print_price", division_cycles / SAMPLES);
+    printf("%-40s %10lu cycles/op\n",
+           "cortex-m0 model: uint division",
+           uint_divide_cycles / SAMPLES);
+    printf("%-40s %10lu cycles/op\n", "cortex-m0 model: print_uint", uint_chunked_cycles / SAMPLES);
+    return 0;
+}
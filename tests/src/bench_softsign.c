@@ -0,0 +1,133 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "softsign.h"
+#include "stellar_api.h"
+
+#define BATCH_SIZE       20000
+#define LATENCY_ROUNDS   2000
+#define MAX_BENCH_WORKERS 64
+
+/* SHA256("Public Global Stellar Network ; September 2015") */
+static const uint8_t public_network_id[32] = {
+    0x7a, 0xc3, 0x39, 0x97, 0x54, 0x4e, 0x31, 0x75, 0xd2, 0x66, 0xbd, 0x02, 0x24, 0x39, 0xb2, 0x2c,
+    0xdb, 0x16, 0x50, 0x8c, 0x01, 0x16, 0x3f, 0x26, 0xe5, 0xcb, 0x2a, 0x3e, 0x10, 0x45, 0xa9, 0x79};
+
+static uint8_t *write32(uint8_t *p, uint32_t n) {
+    p[0] = n >> 24;
+    p[1] = n >> 16;
+    p[2] = n >> 8;
+    p[3] = n;
+    return p + 4;
+}
+
+static uint8_t *write64(uint8_t *p, uint64_t n) {
+    p = write32(p, n >> 32);
+    return write32(p, n);
+}
+
+/* opCount payments of 1 XLM with a text memo */
+static uint32_t build_envelope(uint8_t *raw, uint8_t opCount) {
+    uint8_t *p = raw;
+
+    memcpy(p, public_network_id, 32);
+    p += 32;
+    p = write32(p, 2);  // ENVELOPE_TYPE_TX
+    p = write32(p, PUBLIC_KEY_TYPE_ED25519);
+    memset(p, 0x42, 32);
+    p += 32;
+    p = write32(p, 100 * opCount);  // fee
+    p = write64(p, 1234567890);     // sequence number
+    p = write32(p, 0);              // no time bounds
+    p = write32(p, MEMO_TEXT);
+    p = write32(p, 8);
+    memcpy(p, "invoice1", 8);
+    p += 8;
+    p = write32(p, opCount);
+    for (int i = 0; i < opCount; i++) {
+        p = write32(p, 0);  // no operation source
+        p = write32(p, XDR_OPERATION_TYPE_PAYMENT);
+        p = write32(p, PUBLIC_KEY_TYPE_ED25519);
+        memset(p, 0x10 + i, 32);
+        p += 32;
+        p = write32(p, ASSET_TYPE_NATIVE);
+        p = write64(p, 10000000);
+    }
+    p = write32(p, 0);  // no extension
+    return p - raw;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static void bench_workers(const char *name,
+                          const uint8_t *raw,
+                          uint32_t rawLength,
+                          unsigned int workers) {
+    static const uint8_t privateKey[32] = {1};
+    static softsign_envelope_t envelopes[BATCH_SIZE];
+    static softsign_result_t results[BATCH_SIZE];
+    static uint64_t latencies[LATENCY_ROUNDS];
+
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        envelopes[i].raw = raw;
+        envelopes[i].rawLength = rawLength;
+    }
+    softsign_pool_t *pool = softsign_pool_new(privateKey, workers);
+    if (pool == NULL) {
+        fprintf(stderr, "cannot start %u workers\n", workers);
+        exit(1);
+    }
+
+    uint64_t start = bench_now_ns();
+    softsign_batch(pool, envelopes, results, BATCH_SIZE, NULL, NULL);
+    uint64_t elapsed = bench_now_ns() - start;
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        if (results[i].sw != 0x9000) {
+            fprintf(stderr, "%s: envelope rejected with 0x%04x\n", name, results[i].sw);
+            exit(1);
+        }
+    }
+
+    // latency of a transaction submitted alongside one per other worker
+    for (int i = 0; i < LATENCY_ROUNDS; i++) {
+        start = bench_now_ns();
+        softsign_batch(pool, envelopes, results, workers, NULL, NULL);
+        latencies[i] = bench_now_ns() - start;
+    }
+    softsign_pool_free(pool);
+
+    qsort(latencies, LATENCY_ROUNDS, sizeof(latencies[0]), compare_u64);
+    double txPerSecond = BATCH_SIZE * 1e9 / elapsed;
+    printf("%-12s %2u workers %10.0f tx/s %9.0f tx/s/core %8.1f us p50 %8.1f us p99\n",
+           name,
+           workers,
+           txPerSecond,
+           txPerSecond / workers,
+           latencies[LATENCY_ROUNDS / 2] / 1e3,
+           latencies[LATENCY_ROUNDS * 99 / 100] / 1e3);
+}
+
+int main() {
+    static uint8_t small[MAX_RAW_TX];
+    static uint8_t large[MAX_RAW_TX];
+    uint32_t smallLength = build_envelope(small, 1);
+    uint32_t largeLength = build_envelope(large, 12);
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (cores < 1) {
+        cores = 1;
+    } else if (cores > MAX_BENCH_WORKERS) {
+        cores = MAX_BENCH_WORKERS;
+    }
+    for (unsigned int workers = 1; workers <= cores; workers *= 2) {
+        bench_workers("1 payment", small, smallLength, workers);
+        bench_workers("12 payments", large, largeLength, workers);
+    }
+    return 0;
+}
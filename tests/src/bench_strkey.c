@@ -0,0 +1,54 @@
+#include <stdlib.h>
+
+#include "bench.h"
+#include "stellar_api.h"
+
+#define KEY_COUNT (1 << 16)
+
+/* runs stmt rounds times and prints the throughput of a single core */
+#define BENCH_KEYS(name, rounds, stmt)                                       \
+    do {                                                                     \
+        uint64_t _start = bench_now_ns();                                    \
+        for (int _r = 0; _r < (rounds); _r++) {                              \
+            stmt;                                                            \
+        }                                                                    \
+        double _seconds = (bench_now_ns() - _start) / 1e9;                   \
+        double _keys = (double) (rounds) * KEY_COUNT;                        \
+        printf("%-40s %10.2f Mkeys/s\n", name, _keys / _seconds / 1e6);     \
+    } while (0)
+
+static uint8_t keys[KEY_COUNT][32];
+static char addresses[KEY_COUNT][57];
+static uint8_t decoded[KEY_COUNT][32];
+static uint8_t valid[KEY_COUNT / 8];
+
+int main() {
+    srand(0);
+    for (size_t i = 0; i < KEY_COUNT; i++) {
+        for (int j = 0; j < 32; j++) {
+            keys[i][j] = rand();
+        }
+    }
+
+    BENCH_KEYS("encode_public_key", 20, {
+        for (size_t i = 0; i < KEY_COUNT; i++) {
+            encode_public_key(keys[i], addresses[i]);
+        }
+        bench_clobber(addresses);
+    });
+    BENCH_KEYS("encode_public_keys_bulk", 20, {
+        encode_public_keys_bulk(keys, KEY_COUNT, addresses);
+        bench_clobber(addresses);
+    });
+    BENCH_KEYS("decode_strkey", 20, {
+        for (size_t i = 0; i < KEY_COUNT; i++) {
+            decode_strkey(addresses[i], STRKEY_VERSION_ACCOUNT_ID, decoded[i]);
+        }
+        bench_clobber(decoded);
+    });
+    BENCH_KEYS("decode_strkeys_bulk", 20, {
+        decode_strkeys_bulk(addresses, KEY_COUNT, STRKEY_VERSION_ACCOUNT_ID, decoded, valid);
+        bench_clobber(decoded);
+    });
+    return 0;
+}
@@ -0,0 +1,267 @@
+/*
+ * Host implementation of the os and cx functions used by the request handlers, backed by libcrypto.
+ * Keys are derived from the seed of the speculos default mnemonic, so that the handlers return
+ * the same keys and signatures as the emulator.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/bn.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/sha.h>
+
+#include "os.h"
+#include "cx.h"
+#include "os_io_seproxyhal.h"
+#include "host_os.h"
+
+static const char MNEMONIC[] =
+    "glory promote mansion idle axis finger extra february uncover one trip resource lawn turtle "
+    "enact monster seven myth punch hobby comfort wild raise skin";
+
+try_context_t *G_try_last_open_context;
+unsigned char G_io_apdu_buffer[IO_APDU_BUFFER_SIZE];
+
+host_responses_t host_responses;
+unsigned int host_derivations;
+unsigned int host_signatures;
+
+void os_longjmp(unsigned int exception) {
+    if (G_try_last_open_context == NULL) {
+        fprintf(stderr, "uncaught exception 0x%04x\n", exception);
+        abort();
+    }
+    longjmp(G_try_last_open_context->jmp_buf, exception);
+}
+
+void os_sched_exit(int exit_code) {
+    (void) exit_code;
+    THROW(EXCEPTION_APPEXIT);
+}
+
+void io_seproxyhal_io_heartbeat(void) {
+}
+
+/* there is no next command on the host, the tests call the handlers */
+unsigned short io_exchange(unsigned char channel_and_flags, unsigned short tx_len) {
+    (void) channel_and_flags;
+    memcpy(host_responses.data, G_io_apdu_buffer, tx_len);
+    host_responses.length = tx_len;
+    host_responses.count++;
+    return 0;
+}
+
+/* N_state_pic is writable in the host build */
+void nvm_write(void *dst_adr, void *src_adr, unsigned int src_len) {
+    if (src_adr == NULL) {
+        memset(dst_adr, 0, src_len);
+    } else {
+        memcpy(dst_adr, src_adr, src_len);
+    }
+}
+
+static const uint8_t *get_seed(void) {
+    static uint8_t seed[64];
+    static bool ready;
+
+    if (!ready) {
+        // BIP39: PBKDF2-HMAC-SHA512 of the mnemonic, salted with "mnemonic" and no passphrase
+        if (!PKCS5_PBKDF2_HMAC(MNEMONIC,
+                               strlen(MNEMONIC),
+                               (const unsigned char *) "mnemonic",
+                               8,
+                               2048,
+                               EVP_sha512(),
+                               sizeof(seed),
+                               seed)) {
+            THROW(EXCEPTION);
+        }
+        ready = true;
+    }
+    return seed;
+}
+
+void os_perso_derive_node_bip32_seed_key(unsigned int mode,
+                                         unsigned int curve,
+                                         const unsigned int *path,
+                                         unsigned int pathLength,
+                                         unsigned char *privateKey,
+                                         unsigned char *chain,
+                                         unsigned char *seed_key,
+                                         unsigned int seed_key_length) {
+    uint8_t node[64];  // key, then chain code
+    uint8_t data[1 + 32 + 4];
+
+    if (mode != HDW_ED25519_SLIP10 || curve != CX_CURVE_Ed25519) {
+        THROW(INVALID_PARAMETER);
+    }
+    host_derivations++;
+    if (HMAC(EVP_sha512(), seed_key, seed_key_length, get_seed(), 64, node, NULL) == NULL) {
+        THROW(EXCEPTION);
+    }
+    for (unsigned int i = 0; i < pathLength; i++) {
+        // SLIP-10 only defines hardened children for ed25519
+        if ((path[i] & 0x80000000) == 0) {
+            THROW(INVALID_PARAMETER);
+        }
+        data[0] = 0;
+        memcpy(data + 1, node, 32);
+        data[33] = path[i] >> 24;
+        data[34] = path[i] >> 16;
+        data[35] = path[i] >> 8;
+        data[36] = path[i];
+        if (HMAC(EVP_sha512(), node + 32, 32, data, sizeof(data), node, NULL) == NULL) {
+            THROW(EXCEPTION);
+        }
+    }
+
+    memcpy(privateKey, node, 32);
+    if (chain != NULL) {
+        memcpy(chain, node + 32, 32);
+    }
+    OPENSSL_cleanse(node, sizeof(node));
+    OPENSSL_cleanse(data, sizeof(data));
+}
+
+int cx_hash_sha256(const unsigned char *in,
+                   unsigned int len,
+                   unsigned char *out,
+                   unsigned int out_len) {
+    if (out_len < SHA256_DIGEST_LENGTH) {
+        THROW(INVALID_PARAMETER);
+    }
+    SHA256(in, len, out);
+    return SHA256_DIGEST_LENGTH;
+}
+
+int cx_hmac_sha256(const unsigned char *key,
+                   unsigned int key_len,
+                   const unsigned char *in,
+                   unsigned int len,
+                   unsigned char *mac,
+                   unsigned int mac_len) {
+    if (mac_len < SHA256_DIGEST_LENGTH ||
+        HMAC(EVP_sha256(), key, key_len, in, len, mac, NULL) == NULL) {
+        THROW(INVALID_PARAMETER);
+    }
+    return SHA256_DIGEST_LENGTH;
+}
+
+int cx_ecfp_init_private_key(cx_curve_t curve,
+                             const unsigned char *rawkey,
+                             unsigned int key_len,
+                             cx_ecfp_private_key_t *pvkey) {
+    if (curve != CX_CURVE_Ed25519 || key_len != 32) {
+        THROW(INVALID_PARAMETER);
+    }
+    pvkey->curve = curve;
+    pvkey->d_len = key_len;
+    memcpy(pvkey->d, rawkey, key_len);
+    return key_len;
+}
+
+static EVP_PKEY *get_pkey(const cx_ecfp_private_key_t *pvkey) {
+    EVP_PKEY *pkey = EVP_PKEY_new_raw_private_key(EVP_PKEY_ED25519, NULL, pvkey->d, pvkey->d_len);
+    if (pkey == NULL) {
+        THROW(INVALID_PARAMETER);
+    }
+    return pkey;
+}
+
+/* decompress an Ed25519 point to the SDK layout: 0x04, then x and y big endian */
+static bool decompress_point(const uint8_t *encoded, uint8_t *W) {
+    uint8_t le[32];
+    BN_CTX *bn = BN_CTX_new();
+    BIGNUM *p = BN_new();
+    BIGNUM *d = BN_new();
+    BIGNUM *y = BN_new();
+    BIGNUM *u = BN_new();
+    BIGNUM *v = BN_new();
+    BIGNUM *x = BN_new();
+    bool ok = bn != NULL && p != NULL && d != NULL && y != NULL && u != NULL && v != NULL &&
+              x != NULL;
+
+    memcpy(le, encoded, 32);
+    le[31] &= 0x7f;
+    // p = 2^255 - 19, d = -121665 / 121666
+    ok = ok && BN_set_bit(p, 255) && BN_sub_word(p, 19);
+    ok = ok && BN_set_word(d, 121666) && BN_mod_inverse(d, d, p, bn) != NULL &&
+         BN_mul_word(d, 121665) && BN_sub(d, p, d);
+    // x^2 = (y^2 - 1) / (d y^2 + 1)
+    ok = ok && BN_lebin2bn(le, 32, y) != NULL && BN_mod_sqr(u, y, p, bn);
+    ok = ok && BN_mod_mul(v, d, u, p, bn) && BN_add_word(v, 1) && BN_sub_word(u, 1);
+    ok = ok && BN_mod_inverse(v, v, p, bn) != NULL && BN_mod_mul(u, u, v, p, bn);
+    ok = ok && BN_mod_sqrt(x, u, p, bn) != NULL;
+    if (ok && BN_is_odd(x) != (encoded[31] >> 7)) {
+        ok = BN_sub(x, p, x);
+    }
+    if (ok) {
+        W[0] = 0x04;
+        ok = BN_bn2binpad(x, W + 1, 32) == 32 && BN_bn2binpad(y, W + 33, 32) == 32;
+    }
+
+    BN_free(x);
+    BN_free(v);
+    BN_free(u);
+    BN_free(y);
+    BN_free(d);
+    BN_free(p);
+    BN_CTX_free(bn);
+    return ok;
+}
+
+int cx_ecfp_generate_pair(cx_curve_t curve,
+                          cx_ecfp_public_key_t *pubkey,
+                          cx_ecfp_private_key_t *privkey,
+                          int keepprivate) {
+    uint8_t encoded[32];
+    size_t len = sizeof(encoded);
+
+    if (curve != CX_CURVE_Ed25519 || !keepprivate) {
+        THROW(INVALID_PARAMETER);
+    }
+    EVP_PKEY *pkey = get_pkey(privkey);
+    bool ok = EVP_PKEY_get_raw_public_key(pkey, encoded, &len) == 1 &&
+              decompress_point(encoded, pubkey->W);
+    EVP_PKEY_free(pkey);
+    if (!ok) {
+        THROW(EXCEPTION);
+    }
+    pubkey->curve = curve;
+    pubkey->W_len = 65;
+    return 0;
+}
+
+int cx_eddsa_sign(const cx_ecfp_private_key_t *pvkey,
+                  int mode,
+                  cx_md_t hashID,
+                  const unsigned char *hash,
+                  unsigned int hash_len,
+                  const unsigned char *ctx,
+                  unsigned int ctx_len,
+                  unsigned char *sig,
+                  unsigned int sig_len,
+                  unsigned int *info) {
+    (void) ctx;
+    (void) ctx_len;
+    (void) info;
+    size_t len = sig_len;
+
+    if (mode != CX_LAST || hashID != CX_SHA512 || sig_len < 64) {
+        THROW(INVALID_PARAMETER);
+    }
+    host_signatures++;
+    EVP_PKEY *pkey = get_pkey(pvkey);
+    EVP_MD_CTX *md = EVP_MD_CTX_new();
+    bool ok = md != NULL && EVP_DigestSignInit(md, NULL, NULL, NULL, pkey) == 1 &&
+              EVP_DigestSign(md, sig, &len, hash, hash_len) == 1;
+    EVP_MD_CTX_free(md);
+    EVP_PKEY_free(pkey);
+    if (!ok) {
+        THROW(EXCEPTION);
+    }
+    return (int) len;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+/*
+ * What the host implementation of the os and cx functions records, for the handler tests to check
+ * the responses and the work done by a flow.
+ */
+
+#include "os_io_seproxyhal.h"
+
+/* responses sent with io_exchange(), outside of the command loop: approvals and rejections */
+typedef struct {
+    unsigned char data[IO_APDU_BUFFER_SIZE];  // the last one, status word included
+    unsigned int length;
+    unsigned int count;
+} host_responses_t;
+
+extern host_responses_t host_responses;
+
+/* seed derivations and signatures */
+extern unsigned int host_derivations;
+extern unsigned int host_signatures;
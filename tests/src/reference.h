@@ -0,0 +1,179 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* former implementations, kept as references for the tests and benchmarks */
+
+/* bit-at-a-time CRC16-XModem */
+static inline uint16_t crc16_bitwise(const uint8_t *data, size_t length) {
+    uint16_t crc = 0;
+    while (length--) {
+        crc ^= *data++ << 8;
+        for (int i = 0; i < 8; i++) {
+            crc = crc & 0x8000 ? crc << 1 ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+/**
+ * adapted from
+ * https://stash.forgerock.org/projects/OPENAM/repos/forgerock-authenticator-ios/browse/ForgeRock-Authenticator/base32.c
+ */
+static inline int base32_encode(const uint8_t *data, int length, char *result, int bufSize) {
+    static const char base32Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+    int count = 0;
+
+    if (length < 0 || length > (1 << 28)) {
+        return -1;
+    }
+
+    if (length > 0) {
+        int buffer = data[0];
+        int next = 1;
+        int bitsLeft = 8;
+        int quantum = 8;
+
+        while (count < bufSize && (bitsLeft > 0 || next < length)) {
+            if (bitsLeft < 5) {
+                if (next < length) {
+                    buffer <<= 8;
+                    buffer |= data[next++] & 0xFF;
+                    bitsLeft += 8;
+                } else {
+                    int pad = 5 - bitsLeft;
+                    buffer <<= pad;
+                    bitsLeft += pad;
+                }
+            }
+
+            int idx = 0x1F & (buffer >> (bitsLeft - 5));
+            bitsLeft -= 5;
+            result[count++] = base32Alphabet[idx];
+
+            // Track the characters which make up a single quantum of 8 characters
+            quantum--;
+            if (quantum == 0) {
+                quantum = 8;
+            }
+        }
+
+        // If the number of encoded characters does not make a full quantum, insert padding
+        if (quantum != 8) {
+            while (quantum > 0 && count < bufSize) {
+                result[count++] = '=';
+                quantum--;
+            }
+        }
+    }
+
+    // Finally check if we exceeded buffer size.
+    if (count < bufSize) {
+        result[count] = '\000';
+        return count;
+    } else {
+        return -1;
+    }
+}
+
+/* digits by repeated 64-bit division, then reversed */
+static inline int print_uint_divide(uint64_t l, char *out, size_t out_len) {
+    char buffer[21];
+    uint64_t dVal = l;
+    size_t i, j;
+
+    if (l == 0) {
+        if (out_len < 2) {
+            return -1;
+        }
+        strcpy(out, "0");
+        return 0;
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    for (i = 0; dVal > 0; i++) {
+        buffer[i] = (dVal % 10) + '0';
+        dVal /= 10;
+    }
+    if (out_len <= i) {
+        return -1;
+    }
+    for (j = 0; j < i; j++) {
+        out[j] = buffer[i - j - 1];
+    }
+    out[i] = '\0';
+    return 0;
+}
+
+/* unqualified amount: reversed digits with the decimal point inserted, trailing zeros stripped */
+static inline void print_amount_divide(uint64_t amount, char *out) {
+    char buffer[22] = {0};
+    uint64_t dVal = amount;
+    int i;
+
+    for (i = 0; dVal > 0 || i < 9; i++) {
+        if (dVal > 0) {
+            buffer[i] = (dVal % 10) + '0';
+            dVal /= 10;
+        } else {
+            buffer[i] = '0';
+        }
+        if (i == 6) {
+            i += 1;
+            buffer[i] = '.';
+        }
+    }
+    for (int j = 0; j < i / 2; j++) {
+        char c = buffer[j];
+        buffer[j] = buffer[i - j - 1];
+        buffer[i - j - 1] = c;
+    }
+    i -= 1;
+    while (buffer[i] == '0') {
+        buffer[i] = 0;
+        i -= 1;
+    }
+    if (buffer[i] == '.') buffer[i] = 0;
+    strcpy(out, buffer);
+}
+
+/* base64 with per-byte bound checks and padding patched afterwards */
+static inline void base64_encode_reference(const uint8_t *data, int inLen, char *out) {
+    static const char base64Alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    static const int base64ModTable[] = {0, 2, 1};
+    size_t outLen = 4 * ((inLen + 2) / 3);
+
+    for (int i = 0, j = 0; i < inLen;) {
+        uint32_t octet_a = i < inLen ? data[i++] : 0;
+        uint32_t octet_b = i < inLen ? data[i++] : 0;
+        uint32_t octet_c = i < inLen ? data[i++] : 0;
+
+        uint32_t triple = (octet_a << 0x10) + (octet_b << 0x08) + octet_c;
+
+        out[j++] = base64Alphabet[(triple >> 3 * 6) & 0x3F];
+        out[j++] = base64Alphabet[(triple >> 2 * 6) & 0x3F];
+        out[j++] = base64Alphabet[(triple >> 1 * 6) & 0x3F];
+        out[j++] = base64Alphabet[(triple >> 0 * 6) & 0x3F];
+    }
+
+    for (int i = 0; i < base64ModTable[inLen % 3]; i++) {
+        out[outLen - 1 - i] = '=';
+    }
+    out[outLen] = '\0';
+}
+
+/* hexadecimal with a division and a modulo per byte */
+static inline void print_binary_reference(const uint8_t *in, char *out, uint8_t len) {
+    static const char hexAlphabet[] = "0123456789ABCDEF";
+    out[0] = '0';
+    out[1] = 'x';
+    uint8_t i, j;
+    for (i = 0, j = 2; i < len; i += 1, j += 2) {
+        out[j] = hexAlphabet[in[i] / 16];
+        out[j + 1] = hexAlphabet[in[i] % 16];
+    }
+    out[j] = '\0';
+}
@@ -0,0 +1,854 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+
+#include "os.h"
+#include "cx.h"
+#include "os_io_seproxyhal.h"
+#include "bench.h"
+#include "host_os.h"
+#include "stellar_api.h"
+#include "stellar_jobs.h"
+#include "stellar_types.h"
+#include "stellar_ux.h"
+#include "stellar_vars.h"
+
+static unsigned int screens_shown;
+
+void ui_show_address_init(void) {
+    screens_shown++;
+}
+
+void ui_approve_tx_init(void) {
+    screens_shown++;
+}
+
+void ui_approve_tx_hash_init(void) {
+    screens_shown++;
+}
+
+void ui_idle(void) {
+}
+
+/* 44'/148'/0' and the address speculos returns for it */
+static const uint8_t PATH[] = {3, 0x80, 0, 0, 0x2c, 0x80, 0, 0, 0x94, 0x80, 0, 0, 0};
+static const char ADDRESS[] = "GCNCEJIAZ5D3APIF5XWAJ3JSSTHM4HPHE7GK3NAB6R6WWSZDB2A2BQ5B";
+
+/* run a handler the way handle_apdu() does, returns the status word it throws or 0 */
+#define CALL_HANDLER(call)         \
+    ({                             \
+        unsigned short sw = 0;     \
+        BEGIN_TRY {                \
+            TRY {                  \
+                call;              \
+            }                      \
+            CATCH_OTHER(e) {       \
+                sw = e;            \
+            }                      \
+            FINALLY {              \
+            }                      \
+        }                          \
+        END_TRY;                   \
+        sw;                        \
+    })
+
+static void verify_signature(const uint8_t *publicKey,
+                             const uint8_t *msg,
+                             size_t msgLength,
+                             const uint8_t *signature) {
+    EVP_PKEY *pkey = EVP_PKEY_new_raw_public_key(EVP_PKEY_ED25519, NULL, publicKey, 32);
+    EVP_MD_CTX *md = EVP_MD_CTX_new();
+    assert_non_null(pkey);
+    assert_non_null(md);
+    assert_int_equal(EVP_DigestVerifyInit(md, NULL, NULL, NULL, pkey), 1);
+    assert_int_equal(EVP_DigestVerify(md, signature, 64, msg, msgLength), 1);
+    EVP_MD_CTX_free(md);
+    EVP_PKEY_free(pkey);
+}
+
+static void setup_request(void) {
+    reset_ctx();
+    memset(G_io_apdu_buffer, 0, sizeof(G_io_apdu_buffer));
+    memset(&host_responses, 0, sizeof(host_responses));
+    host_signatures = 0;
+    screens_shown = 0;
+}
+
+static size_t read_testcase(const char *name, uint8_t *raw) {
+    char path[64];
+    snprintf(path, sizeof(path), "../testcases/%s.raw", name);
+    FILE *f = fopen(path, "rb");
+    assert_non_null(f);
+    size_t rawLength = fread(raw, 1, MAX_RAW_TX, f);
+    fclose(f);
+    assert_true(rawLength > 0);
+    return rawLength;
+}
+
+/* upload the paths and the envelope in chunks, returns the status word of the last one */
+static unsigned short send_tx_paths(uint8_t ins,
+                                    uint8_t first,
+                                    const uint8_t *paths,
+                                    size_t pathsLength,
+                                    const uint8_t *raw,
+                                    size_t rawLength) {
+    uint8_t data[150];
+    volatile unsigned int flags = 0;
+    volatile unsigned int tx = 0;
+    size_t offset = 0;
+    unsigned short sw;
+
+    do {
+        size_t length = 0;
+        if (offset == 0) {
+            memcpy(data, paths, pathsLength);
+            length = pathsLength;
+        }
+        size_t chunk = rawLength - offset;
+        if (chunk > sizeof(data) - length) {
+            chunk = sizeof(data) - length;
+        }
+        memcpy(data + length, raw + offset, chunk);
+        uint8_t p1 = offset == 0 ? first : P1_MORE;
+        offset += chunk;
+        uint8_t p2 = offset < rawLength ? P2_MORE : P2_LAST;
+        if (ins == INS_QUEUE_TX) {
+            sw = CALL_HANDLER(handle_queue_tx(p1, p2, data, length + chunk, &tx));
+        } else {
+            sw = CALL_HANDLER(handle_sign_tx(p1, p2, data, length + chunk, &flags));
+        }
+    } while (offset < rawLength && sw == 0x9000);
+    return sw;
+}
+
+static unsigned short send_tx(const uint8_t *raw, size_t rawLength) {
+    return send_tx_paths(INS_SIGN_TX, P1_FIRST, PATH, sizeof(PATH), raw, rawLength);
+}
+
+/* status word of the last response sent from a UX callback */
+static unsigned short response_sw(void) {
+    assert_true(host_responses.length >= 2);
+    return host_responses.data[host_responses.length - 2] << 8 |
+           host_responses.data[host_responses.length - 1];
+}
+
+static void get_public_key(uint8_t *publicKey) {
+    uint8_t data[sizeof(PATH)];
+    volatile unsigned int flags = 0;
+    volatile unsigned int tx = 0;
+
+    memcpy(data, PATH, sizeof(PATH));
+    assert_int_equal(CALL_HANDLER(handle_get_public_key(P1_NO_SIGNATURE,
+                                                        P2_NO_CONFIRM,
+                                                        data,
+                                                        sizeof(data),
+                                                        &flags,
+                                                        &tx)),
+                     0x9000);
+    memcpy(publicKey, G_io_apdu_buffer, 32);
+}
+
+void test_get_public_key(void **state) {
+    (void) state;
+    uint8_t data[sizeof(PATH)];
+    volatile unsigned int flags = 0;
+    volatile unsigned int tx = 0;
+    char address[57];
+
+    setup_request();
+    // the second request is served from the session cache
+    for (int i = 0; i < 2; i++) {
+        memcpy(data, PATH, sizeof(PATH));
+        assert_int_equal(CALL_HANDLER(handle_get_public_key(P1_NO_SIGNATURE,
+                                                            P2_NO_CONFIRM,
+                                                            data,
+                                                            sizeof(data),
+                                                            &flags,
+                                                            &tx)),
+                         0x9000);
+        assert_int_equal(tx, 32);
+        encode_public_key(G_io_apdu_buffer, address);
+        assert_string_equal(address, ADDRESS);
+    }
+
+    // SLIP-10 only has hardened ed25519 children
+    data[9] = 0;
+    assert_int_not_equal(
+        CALL_HANDLER(
+            handle_get_public_key(P1_NO_SIGNATURE, P2_NO_CONFIRM, data, sizeof(data), &flags, &tx)),
+        0x9000);
+
+    data[0] = MAX_BIP32_LEN + 1;
+    assert_int_equal(
+        CALL_HANDLER(
+            handle_get_public_key(P1_NO_SIGNATURE, P2_NO_CONFIRM, data, sizeof(data), &flags, &tx)),
+        0x6a80);
+}
+
+void test_get_public_key_signature(void **state) {
+    (void) state;
+    uint8_t data[sizeof(PATH) + 5];
+    volatile unsigned int flags = 0;
+    volatile unsigned int tx = 0;
+
+    setup_request();
+    memcpy(data, PATH, sizeof(PATH));
+    memcpy(data + sizeof(PATH), "hello", 5);
+    assert_int_equal(
+        CALL_HANDLER(
+            handle_get_public_key(P1_SIGNATURE, P2_NO_CONFIRM, data, sizeof(data), &flags, &tx)),
+        0x9000);
+    assert_int_equal(tx, 32 + 64);
+    verify_signature(G_io_apdu_buffer, (const uint8_t *) "hello", 5, G_io_apdu_buffer + 32);
+}
+
+void test_get_public_keys(void **state) {
+    (void) state;
+    // 44'/148', accounts 0' and 1'
+    uint8_t data[] = {2, 0x80, 0, 0, 0x2c, 0x80, 0, 0, 0x94, 0, 0, 0, 0, 2};
+    volatile unsigned int tx = 0;
+    char address[57];
+
+    setup_request();
+    assert_int_equal(CALL_HANDLER(handle_get_public_keys(data, sizeof(data), &tx)), 0x9000);
+    assert_int_equal(tx, 1 + 2 * 32);
+    assert_int_equal(G_io_apdu_buffer[0], 2);
+    encode_public_key(G_io_apdu_buffer + 1, address);
+    assert_string_equal(address, ADDRESS);
+    assert_true(memcmp(G_io_apdu_buffer + 1, G_io_apdu_buffer + 33, 32) != 0);
+}
+
+void test_nv_pubkey_cache(void **state) {
+    (void) state;
+    const uint32_t bip32[3] = {0x8000002C, 0x80000094, 0x80000000};
+    const uint8_t keyA[32] = {0xa};
+    const uint8_t keyB[32] = {0xb};
+    uint8_t publicKey[32] = {1, 2, 3};
+    uint8_t data[sizeof(PATH)];
+    volatile unsigned int flags = 0;
+    volatile unsigned int tx = 0;
+    char address[57];
+
+    // entries only verify with the key of the seed they were stored under
+    memset(&N_state_pic, 0, sizeof(N_state_pic));
+    nv_load();
+    nv_pubkey_cache_store(keyA, bip32, 3, publicKey);
+    memset(publicKey, 0, sizeof(publicKey));
+    assert_true(nv_pubkey_cache_lookup(keyA, bip32, 3, publicKey, false));
+    assert_int_equal(publicKey[2], 3);
+    assert_false(nv_pubkey_cache_lookup(keyB, bip32, 3, publicKey, false));
+    assert_false(nv_pubkey_cache_lookup(keyA, bip32, 2, publicKey, false));
+    N_stellar_pstate.pubkeyCache[0].publicKey[0] ^= 1;
+    assert_false(nv_pubkey_cache_lookup(keyA, bip32, 3, publicKey, false));
+    nv_pubkey_cache_clear();
+
+    // disabled: nothing is persisted
+    setup_request();
+    clear_nv_tag_key();
+    memcpy(data, PATH, sizeof(PATH));
+    assert_int_equal(CALL_HANDLER(handle_get_public_key(P1_NO_SIGNATURE,
+                                                        P2_NO_CONFIRM,
+                                                        data,
+                                                        sizeof(data),
+                                                        &flags,
+                                                        &tx)),
+                     0x9000);
+    assert_int_equal(N_stellar_pstate.pubkeyCache[0].bip32Len, 0);
+
+    uint8_t enabled = 1;
+    nv_write(&N_stellar_pstate.pubkeyCaching, &enabled, 1);
+    nv_commit();
+    for (int launch = 0; launch < 3; launch++) {
+        nv_load();
+        setup_request();
+        clear_nv_tag_key();
+        if (launch == 2) {
+            // a corrupted entry is derived again and rewritten
+            N_stellar_pstate.pubkeyCache[0].publicKey[0] ^= 0x80;
+        }
+        memcpy(data, PATH, sizeof(PATH));
+        assert_int_equal(CALL_HANDLER(handle_get_public_key(P1_NO_SIGNATURE,
+                                                            P2_NO_CONFIRM,
+                                                            data,
+                                                            sizeof(data),
+                                                            &flags,
+                                                            &tx)),
+                         0x9000);
+        encode_public_key(G_io_apdu_buffer, address);
+        assert_string_equal(address, ADDRESS);
+        assert_int_equal(N_stellar_pstate.pubkeyCache[0].bip32Len, 3);
+    }
+
+    // discovery reads the caches but never writes the flash
+    uint8_t keys[] = {2, 0x80, 0, 0, 0x2c, 0x80, 0, 0, 0x94, 0, 0, 0, 0, 7};
+    uint32_t commits = nv_stats.commits;
+    assert_int_equal(CALL_HANDLER(handle_get_public_keys(keys, sizeof(keys), &tx)), 0x9000);
+    assert_int_equal(tx, 1 + 7 * 32);
+    encode_public_key(G_io_apdu_buffer + 1, address);
+    assert_string_equal(address, ADDRESS);
+    assert_int_equal(nv_stats.commits, commits);
+    assert_int_equal(N_stellar_pstate.pubkeyCache[1].bip32Len, 0);
+
+    // the least recently used entry is evicted, the order survives a relaunch
+    uint32_t paths[NV_PUBKEY_CACHE_SIZE + 1][3];
+    nv_pubkey_cache_clear();
+    for (uint8_t i = 0; i <= NV_PUBKEY_CACHE_SIZE; i++) {
+        memcpy(paths[i], bip32, sizeof(bip32));
+        paths[i][2] += i;
+    }
+    for (uint8_t i = 0; i < NV_PUBKEY_CACHE_SIZE; i++) {
+        nv_pubkey_cache_store(keyA, paths[i], 3, publicKey);
+    }
+    assert_true(nv_pubkey_cache_lookup(keyA, paths[0], 3, publicKey, true));
+    commits = nv_stats.commits;
+    assert_true(nv_pubkey_cache_lookup(keyA, paths[0], 3, publicKey, true));
+    assert_int_equal(nv_stats.commits, commits);
+    nv_load();
+    nv_pubkey_cache_store(keyA, paths[NV_PUBKEY_CACHE_SIZE], 3, publicKey);
+    assert_true(nv_pubkey_cache_lookup(keyA, paths[0], 3, publicKey, false));
+    assert_false(nv_pubkey_cache_lookup(keyA, paths[1], 3, publicKey, false));
+    for (uint8_t i = 2; i <= NV_PUBKEY_CACHE_SIZE; i++) {
+        assert_true(nv_pubkey_cache_lookup(keyA, paths[i], 3, publicKey, false));
+    }
+
+    memset(&N_state_pic, 0, sizeof(N_state_pic));
+    nv_load();
+}
+
+void test_sign_tx(void **state) {
+    (void) state;
+    uint8_t raw[MAX_RAW_TX];
+    uint8_t hash[32];
+    uint8_t publicKey[32];
+
+    setup_request();
+    get_public_key(publicKey);
+    size_t rawLength = read_testcase("txSimple", raw);
+    unsigned int derivations = host_derivations;
+
+    // the first screen is shown right after parsing, before any derivation or signature
+    assert_int_equal(send_tx(raw, rawLength), 0);
+    assert_int_equal(screens_shown, 1);
+    assert_int_equal(ctx.state, STATE_APPROVE_TX);
+    assert_int_equal(host_derivations, derivations);
+    assert_int_equal(host_signatures, 0);
+
+    // the key is derived while the user reviews
+    while (jobs_run_slice()) {
+    }
+    assert_int_equal(host_derivations, derivations + 1);
+
+    // the signature is computed on approval
+    io_seproxyhal_touch_tx_ok(NULL);
+    assert_int_equal(host_responses.count, 1);
+    assert_int_equal(response_sw(), 0x9000);
+    assert_int_equal(host_responses.length, 64 + 2);
+    SHA256(raw, rawLength, hash);
+    verify_signature(publicKey, hash, 32, host_responses.data);
+
+    // an answered request cannot be approved again
+    io_seproxyhal_touch_tx_ok(NULL);
+    assert_int_equal(response_sw(), 0x6985);
+    assert_int_equal(host_responses.length, 2);
+    assert_int_equal(host_signatures, 1);
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t median(uint64_t *samples, size_t count) {
+    qsort(samples, count, sizeof(samples[0]), compare_u64);
+    return samples[count / 2];
+}
+
+#define TIMING_ROUNDS 64
+
+/*
+ * Time to the first screen, and where the derivation and the signature went. Before they were
+ * deferred, both ran in handle_sign_tx() ahead of the first screen, for rejected transactions too.
+ */
+void test_sign_tx_timing(void **state) {
+    (void) state;
+    uint8_t raw[MAX_RAW_TX];
+    uint64_t firstScreen[TIMING_ROUNDS];
+    uint64_t derivation[TIMING_ROUNDS];
+    uint64_t approval[TIMING_ROUNDS];
+
+    setup_request();
+    size_t rawLength = read_testcase("txSimple", raw);
+    for (int i = 0; i < TIMING_ROUNDS; i++) {
+        uint64_t start = bench_now_ns();
+        assert_int_equal(send_tx(raw, rawLength), 0);
+        firstScreen[i] = bench_now_ns() - start;
+
+        start = bench_now_ns();
+        while (jobs_run_slice()) {
+        }
+        derivation[i] = bench_now_ns() - start;
+
+        start = bench_now_ns();
+        io_seproxyhal_touch_tx_ok(NULL);
+        approval[i] = bench_now_ns() - start;
+        assert_int_equal(response_sw(), 0x9000);
+    }
+    print_message("median of %d: first screen %llu us, derivation %llu us, signature %llu us\n",
+                  TIMING_ROUNDS,
+                  (unsigned long long) median(firstScreen, TIMING_ROUNDS) / 1000,
+                  (unsigned long long) median(derivation, TIMING_ROUNDS) / 1000,
+                  (unsigned long long) median(approval, TIMING_ROUNDS) / 1000);
+}
+
+void test_sign_tx_reject(void **state) {
+    (void) state;
+    uint8_t raw[MAX_RAW_TX];
+
+    setup_request();
+    size_t rawLength = read_testcase("txSimple", raw);
+    unsigned int derivations = host_derivations;
+    assert_int_equal(send_tx(raw, rawLength), 0);
+
+    // a rejection signs nothing, and only derives if the review gave the ticker time to
+    io_seproxyhal_touch_tx_cancel(NULL);
+    assert_int_equal(response_sw(), 0x6985);
+    assert_int_equal(host_responses.length, 2);
+    assert_int_equal(ctx.state, STATE_NONE);
+
+    io_seproxyhal_touch_tx_ok(NULL);
+    assert_int_equal(response_sw(), 0x6985);
+    assert_int_equal(host_responses.length, 2);
+    assert_int_equal(host_derivations, derivations);
+    assert_int_equal(host_signatures, 0);
+}
+
+void test_sign_tx_replaced(void **state) {
+    (void) state;
+    uint8_t raw[MAX_RAW_TX];
+    uint8_t data[sizeof(PATH) + 64];
+    const uint8_t zero[HASH_SIZE] = {0};
+    volatile unsigned int flags = 0;
+
+    setup_request();
+    size_t rawLength = read_testcase("txSimple", raw);
+    assert_int_equal(send_tx(raw, rawLength), 0);
+    while (jobs_run_slice()) {
+    }
+
+    // a request that does not parse replaces the one on screen, which stays displayed
+    memcpy(data, PATH, sizeof(PATH));
+    memset(data + sizeof(PATH), 0x42, 64);
+    assert_int_equal(CALL_HANDLER(handle_sign_tx(P1_FIRST, P2_LAST, data, sizeof(data), &flags)),
+                     0x6800);
+    assert_int_equal(ctx.state, STATE_NONE);
+    assert_memory_equal(ctx.req.tx.hash, zero, HASH_SIZE);
+
+    // approving what is on screen signs neither transaction
+    io_seproxyhal_touch_tx_ok(NULL);
+    assert_int_equal(response_sw(), 0x6985);
+    assert_int_equal(host_responses.length, 2);
+    assert_int_equal(host_signatures, 0);
+
+    // nor does approving a request still being uploaded
+    assert_int_equal(send_tx(raw, rawLength), 0);
+    memcpy(data + sizeof(PATH), raw, 64);
+    assert_int_equal(CALL_HANDLER(handle_sign_tx(P1_FIRST, P2_MORE, data, sizeof(data), &flags)),
+                     0x9000);
+    io_seproxyhal_touch_tx_ok(NULL);
+    assert_int_equal(response_sw(), 0x6985);
+    assert_int_equal(host_signatures, 0);
+}
+
+void test_sign_tx_multi_path(void **state) {
+    (void) state;
+    // 44'/148', accounts 0' to 2'
+    uint8_t keys[] = {2, 0x80, 0, 0, 0x2c, 0x80, 0, 0, 0x94, 0, 0, 0, 0, 3};
+    uint8_t paths[1 + 3 * sizeof(PATH)];
+    uint8_t publicKeys[3][32];
+    uint8_t raw[MAX_RAW_TX];
+    uint8_t hash[32];
+    volatile unsigned int tx = 0;
+
+    setup_request();
+    assert_int_equal(CALL_HANDLER(handle_get_public_keys(keys, sizeof(keys), &tx)), 0x9000);
+    memcpy(publicKeys, G_io_apdu_buffer + 1, sizeof(publicKeys));
+    pubkey_cache_clear();
+
+    paths[0] = 3;
+    for (uint8_t i = 0; i < 3; i++) {
+        memcpy(paths + 1 + i * sizeof(PATH), PATH, sizeof(PATH));
+        paths[i * sizeof(PATH) + sizeof(PATH)] = i;
+    }
+    size_t rawLength = read_testcase("txSimple", raw);
+    assert_int_equal(
+        send_tx_paths(INS_SIGN_TX, P1_FIRST_MULTI_PATH, paths, sizeof(paths), raw, rawLength), 0);
+    assert_int_equal(ctx.req.tx.pathCount, 3);
+    while (jobs_run_slice()) {
+    }
+
+    // a hint, the last 4 bytes of the public key, before the signature of each path
+    io_seproxyhal_touch_tx_ok(NULL);
+    assert_int_equal(response_sw(), 0x9000);
+    assert_int_equal(host_responses.length, 3 * (4 + 64) + 2);
+    assert_int_equal(host_signatures, 3);
+    SHA256(raw, rawLength, hash);
+    for (uint8_t i = 0; i < 3; i++) {
+        const uint8_t *signature = host_responses.data + i * (4 + 64);
+        assert_memory_equal(signature, publicKeys[i] + 28, 4);
+        verify_signature(publicKeys[i], hash, 32, signature + 4);
+    }
+}
+
+void test_sign_tx_hash(void **state) {
+    (void) state;
+    uint8_t data[sizeof(PATH) + HASH_SIZE];
+    uint8_t publicKey[32];
+    uint8_t enabled = 1;
+    volatile unsigned int flags = 0;
+
+    setup_request();
+    get_public_key(publicKey);
+    nv_write(&N_stellar_pstate.hashSigning, &enabled, 1);
+    memcpy(data, PATH, sizeof(PATH));
+    memset(data + sizeof(PATH), 0x5a, HASH_SIZE);
+    assert_int_equal(CALL_HANDLER(handle_sign_tx_hash(data, sizeof(data), &flags)), 0);
+    assert_int_equal(ctx.state, STATE_APPROVE_TX_HASH);
+
+    io_seproxyhal_touch_tx_ok(NULL);
+    assert_int_equal(response_sw(), 0x9000);
+    assert_int_equal(host_responses.length, 64 + 2);
+    verify_signature(publicKey, data + sizeof(PATH), HASH_SIZE, host_responses.data);
+
+    enabled = 0;
+    nv_write(&N_stellar_pstate.hashSigning, &enabled, 1);
+}
+
+#define BATCH_HASHES 5
+
+/* upload the path and BATCH_HASHES hashes of 0x01, 0x02, ..., in two chunks */
+static unsigned short send_hashes(uint8_t hashes[BATCH_HASHES][HASH_SIZE]) {
+    uint8_t data[sizeof(PATH) + 3 * HASH_SIZE];
+    volatile unsigned int flags = 0;
+    volatile unsigned int tx = 0;
+
+    for (uint8_t i = 0; i < BATCH_HASHES; i++) {
+        memset(hashes[i], i + 1, HASH_SIZE);
+    }
+    memcpy(data, PATH, sizeof(PATH));
+    memcpy(data + sizeof(PATH), hashes, 3 * HASH_SIZE);
+    unsigned short sw = CALL_HANDLER(
+        handle_sign_tx_hashes(P1_FIRST, P2_MORE, data, sizeof(data), &flags, &tx));
+    if (sw != 0x9000) {
+        return sw;
+    }
+    memcpy(data, hashes[3], 2 * HASH_SIZE);
+    return CALL_HANDLER(handle_sign_tx_hashes(P1_MORE, P2_LAST, data, 2 * HASH_SIZE, &flags, &tx));
+}
+
+static unsigned short next_signatures(volatile unsigned int *tx) {
+    volatile unsigned int flags = 0;
+    return CALL_HANDLER(handle_sign_tx_hashes(P1_NEXT_SIGNATURES, P2_LAST, NULL, 0, &flags, tx));
+}
+
+void test_sign_tx_hashes(void **state) {
+    (void) state;
+    uint8_t hashes[BATCH_HASHES][HASH_SIZE];
+    uint8_t digest[32];
+    uint8_t publicKey[32];
+    uint8_t enabled = 1;
+    volatile unsigned int tx = 0;
+
+    setup_request();
+    get_public_key(publicKey);
+    nv_write(&N_stellar_pstate.hashSigning, &enabled, 1);
+    assert_int_equal(send_hashes(hashes), 0);
+    assert_int_equal(ctx.state, STATE_APPROVE_TX_HASHES);
+    assert_int_equal(screens_shown, 1);
+    SHA256(&hashes[0][0], sizeof(hashes), digest);
+    assert_memory_equal(ctx.req.tx.hash, digest, HASH_SIZE);
+
+    // the approval answers with the first signatures, the host fetches the others
+    io_seproxyhal_touch_tx_ok(NULL);
+    assert_int_equal(response_sw(), 0x9000);
+    assert_int_equal(host_responses.length, 3 * 64 + 2);
+    for (uint8_t i = 0; i < 3; i++) {
+        verify_signature(publicKey, hashes[i], HASH_SIZE, host_responses.data + i * 64);
+    }
+    assert_int_equal(next_signatures(&tx), 0x9000);
+    assert_int_equal(tx, 2 * 64);
+    for (uint8_t i = 0; i < 2; i++) {
+        verify_signature(publicKey, hashes[3 + i], HASH_SIZE, G_io_apdu_buffer + i * 64);
+    }
+    assert_int_equal(host_signatures, BATCH_HASHES);
+    assert_int_equal(ctx.state, STATE_NONE);
+    assert_int_equal(next_signatures(&tx), 0x6985);
+
+    enabled = 0;
+    nv_write(&N_stellar_pstate.hashSigning, &enabled, 1);
+}
+
+void test_sign_tx_hashes_dropped(void **state) {
+    (void) state;
+    uint8_t hashes[BATCH_HASHES][HASH_SIZE];
+    uint8_t data[sizeof(PATH) + HASH_SIZE];
+    const uint8_t zero[HASH_SIZE] = {0};
+    uint8_t publicKey[32];
+    uint8_t enabled = 1;
+    volatile unsigned int flags = 0;
+    volatile unsigned int tx = 0;
+
+    setup_request();
+    nv_write(&N_stellar_pstate.hashSigning, &enabled, 1);
+
+    // another command ends a batch whose signatures were not all fetched
+    assert_int_equal(send_hashes(hashes), 0);
+    io_seproxyhal_touch_tx_ok(NULL);
+    assert_int_equal(response_sw(), 0x9000);
+    get_public_key(publicKey);
+    assert_int_equal(ctx.state, STATE_NONE);
+    assert_int_equal(ctx.req.tx.hashCount, 0);
+    assert_memory_equal(ctx.req.tx.raw, zero, HASH_SIZE);
+    assert_int_equal(next_signatures(&tx), 0x6985);
+    assert_int_equal(host_signatures, 3);
+
+    // a malformed chunk drops the hashes already received
+    memcpy(data, PATH, sizeof(PATH));
+    memset(data + sizeof(PATH), 0x11, HASH_SIZE);
+    assert_int_equal(
+        CALL_HANDLER(handle_sign_tx_hashes(P1_FIRST, P2_MORE, data, sizeof(data), &flags, &tx)),
+        0x9000);
+    assert_int_equal(
+        CALL_HANDLER(handle_sign_tx_hashes(P1_MORE, P2_LAST, data, HASH_SIZE - 1, &flags, &tx)),
+        0x6700);
+    assert_int_equal(ctx.state, STATE_NONE);
+    assert_int_equal(ctx.req.tx.hashCount, 0);
+    assert_memory_equal(ctx.req.tx.raw, zero, HASH_SIZE);
+
+    // a batch replaced while on screen, or rejected, cannot be approved
+    assert_int_equal(send_hashes(hashes), 0);
+    assert_int_equal(
+        CALL_HANDLER(handle_sign_tx_hashes(P1_FIRST, P2_MORE, data, sizeof(data), &flags, &tx)),
+        0x9000);
+    io_seproxyhal_touch_tx_ok(NULL);
+    assert_int_equal(response_sw(), 0x6985);
+    assert_int_equal(send_hashes(hashes), 0);
+    io_seproxyhal_touch_tx_cancel(NULL);
+    io_seproxyhal_touch_tx_ok(NULL);
+    assert_int_equal(response_sw(), 0x6985);
+    assert_int_equal(next_signatures(&tx), 0x6985);
+    assert_int_equal(host_signatures, 3);
+
+    enabled = 0;
+    nv_write(&N_stellar_pstate.hashSigning, &enabled, 1);
+}
+
+/* stage an envelope, returns its id */
+static uint8_t queue_tx(const uint8_t *raw, size_t rawLength) {
+    assert_int_equal(send_tx_paths(INS_QUEUE_TX, P1_FIRST, PATH, sizeof(PATH), raw, rawLength),
+                     0x9000);
+    return G_io_apdu_buffer[0];
+}
+
+/* poll for the oldest result, returns its status, the id and signature are left in the buffer */
+static uint8_t poll_queue(volatile unsigned int *tx) {
+    assert_int_equal(CALL_HANDLER(handle_queue_tx(P1_POLL, P2_LAST, NULL, 0, tx)), 0x9000);
+    return G_io_apdu_buffer[0];
+}
+
+void test_queue_tx(void **state) {
+    (void) state;
+    uint8_t rawA[MAX_RAW_TX];
+    uint8_t rawB[MAX_RAW_TX];
+    uint8_t hash[32];
+    uint8_t publicKey[32];
+    volatile unsigned int tx = 0;
+
+    setup_request();
+    get_public_key(publicKey);
+    size_t rawLengthA = read_testcase("txSimple", rawA);
+    size_t rawLengthB = read_testcase("txMemoText", rawB);
+
+    // the first envelope goes to review, the second waits in the staging slot
+    assert_int_equal(queue_tx(rawA, rawLengthA), 0);
+    assert_int_equal(screens_shown, 1);
+    assert_int_equal(ctx.state, STATE_APPROVE_TX);
+    assert_true(ctx.req.tx.queued);
+    assert_int_equal(queue_tx(rawB, rawLengthB), 1);
+    assert_int_equal(screens_shown, 1);
+    assert_int_equal(send_tx_paths(INS_QUEUE_TX, P1_FIRST, PATH, sizeof(PATH), rawB, rawLengthB),
+                     0x6a84);
+    assert_int_equal(poll_queue(&tx), QUEUE_STATUS_PENDING);
+    assert_int_equal(tx, 1);
+
+    // answers go to the results, there is no command to reply to
+    while (jobs_run_slice()) {
+    }
+    io_seproxyhal_touch_tx_ok(NULL);
+    assert_int_equal(host_responses.count, 0);
+    assert_int_equal(host_signatures, 1);
+    assert_int_equal(screens_shown, 2);
+    assert_int_equal(ctx.req.tx.queueId, 1);
+    io_seproxyhal_touch_tx_cancel(NULL);
+    assert_int_equal(host_responses.count, 0);
+    assert_int_equal(ctx.state, STATE_NONE);
+
+    assert_int_equal(poll_queue(&tx), QUEUE_STATUS_SIGNED);
+    assert_int_equal(tx, 2 + 64);
+    assert_int_equal(G_io_apdu_buffer[1], 0);
+    SHA256(rawA, rawLengthA, hash);
+    verify_signature(publicKey, hash, 32, G_io_apdu_buffer + 2);
+    assert_int_equal(poll_queue(&tx), QUEUE_STATUS_REJECTED);
+    assert_int_equal(tx, 2);
+    assert_int_equal(G_io_apdu_buffer[1], 1);
+    assert_int_equal(poll_queue(&tx), QUEUE_STATUS_PENDING);
+
+    // the screen outlives the review, approving it again signs nothing
+    io_seproxyhal_touch_tx_ok(NULL);
+    assert_int_equal(response_sw(), 0x6985);
+    assert_int_equal(host_signatures, 1);
+}
+
+void test_queue_tx_invalid(void **state) {
+    (void) state;
+    uint8_t raw[MAX_RAW_TX];
+    uint8_t data[64];
+    const uint8_t zero[HASH_SIZE] = {0};
+    volatile unsigned int tx = 0;
+
+    setup_request();
+    size_t rawLength = read_testcase("txSimple", raw);
+
+    // an envelope that does not parse is neither reviewed nor hashed
+    memset(data, 0x42, sizeof(data));
+    assert_int_equal(queue_tx(data, sizeof(data)), 0);
+    assert_int_equal(screens_shown, 0);
+    assert_int_equal(ctx.state, STATE_NONE);
+    assert_false(ctx.req.tx.queued);
+    assert_memory_equal(ctx.req.tx.hash, zero, HASH_SIZE);
+    io_seproxyhal_touch_tx_ok(NULL);
+    assert_int_equal(response_sw(), 0x6985);
+    assert_int_equal(poll_queue(&tx), QUEUE_STATUS_INVALID);
+    assert_int_equal(tx, 2);
+    assert_int_equal(G_io_apdu_buffer[1], 0);
+
+    // the one behind it is reviewed as usual
+    assert_int_equal(queue_tx(data, sizeof(data)), 1);
+    assert_int_equal(queue_tx(raw, rawLength), 2);
+    assert_int_equal(ctx.state, STATE_APPROVE_TX);
+    assert_int_equal(ctx.req.tx.queueId, 2);
+    assert_int_equal(poll_queue(&tx), QUEUE_STATUS_INVALID);
+    io_seproxyhal_touch_tx_ok(NULL);
+    assert_int_equal(poll_queue(&tx), QUEUE_STATUS_SIGNED);
+    assert_int_equal(G_io_apdu_buffer[1], 2);
+    assert_int_equal(host_signatures, 1);
+}
+
+void test_reset_ctx(void **state) {
+    (void) state;
+    uint8_t raw[MAX_RAW_TX];
+    volatile unsigned int tx = 0;
+
+    setup_request();
+    size_t rawLength = read_testcase("txSimple", raw);
+    assert_int_equal(queue_tx(raw, rawLength), 0);
+    assert_int_equal(queue_tx(raw, rawLength), 1);
+    while (jobs_run_slice()) {
+    }
+
+    // another instruction resets the context: the session ends with its review and results
+    reset_ctx();
+    assert_int_equal(ctx.state, STATE_NONE);
+    assert_false(ctx.req.tx.queued);
+    assert_int_equal(poll_queue(&tx), QUEUE_STATUS_PENDING);
+    assert_false(jobs_run_slice());
+    io_seproxyhal_touch_tx_ok(NULL);
+    assert_int_equal(response_sw(), 0x6985);
+    assert_int_equal(host_signatures, 0);
+
+    // ids start over, and the slot takes a new envelope
+    assert_int_equal(queue_tx(raw, rawLength), 0);
+    assert_int_equal(ctx.state, STATE_APPROVE_TX);
+}
+
+void test_swap_sign_tx(void **state) {
+    (void) state;
+    uint8_t raw[MAX_RAW_TX];
+    uint8_t hash[32];
+    uint8_t publicKey[32];
+
+    setup_request();
+    get_public_key(publicKey);
+    size_t rawLength = read_testcase("txMemoText", raw);
+
+    // the payment of txMemoText, as the exchange sets it
+    called_from_swap = true;
+    swap_values.amount = 300000000;
+    swap_values.fees = 100;
+    assert_true(decode_strkey("GCKUD4BHIYSAYHU7HBB5FDSW6CSYH3GSOUBPWD2KE7KNBERP4BSKEJDV",
+                              STRKEY_VERSION_ACCOUNT_ID,
+                              swap_values.destination));
+    strcpy(swap_values.memo, "starlight");
+
+    // a transaction that does not match is rejected once and never signed
+    swap_values.amount++;
+    assert_int_equal(send_tx(raw, rawLength), EXCEPTION_APPEXIT);
+    assert_int_equal(host_responses.count, 1);
+    assert_int_equal(response_sw(), 0x6985);
+    assert_int_equal(host_signatures, 0);
+
+    // the matching one is signed without a review
+    swap_values.amount--;
+    memset(&host_responses, 0, sizeof(host_responses));
+    assert_int_equal(send_tx(raw, rawLength), EXCEPTION_APPEXIT);
+    assert_int_equal(host_responses.count, 1);
+    assert_int_equal(response_sw(), 0x9000);
+    assert_int_equal(host_responses.length, 64 + 2);
+    SHA256(raw, rawLength, hash);
+    verify_signature(publicKey, hash, 32, host_responses.data);
+    assert_int_equal(screens_shown, 0);
+
+    called_from_swap = false;
+    memset(&swap_values, 0, sizeof(swap_values));
+}
+
+void test_sign_tx_hash_disabled(void **state) {
+    (void) state;
+    uint8_t data[sizeof(PATH) + 32] = {0};
+    volatile unsigned int flags = 0;
+
+    setup_request();
+    memcpy(data, PATH, sizeof(PATH));
+    assert_int_equal(CALL_HANDLER(handle_sign_tx_hash(data, sizeof(data), &flags)), 0x6c66);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_get_public_key),
+        cmocka_unit_test(test_get_public_key_signature),
+        cmocka_unit_test(test_get_public_keys),
+        cmocka_unit_test(test_nv_pubkey_cache),
+        cmocka_unit_test(test_sign_tx),
+        cmocka_unit_test(test_sign_tx_timing),
+        cmocka_unit_test(test_sign_tx_reject),
+        cmocka_unit_test(test_sign_tx_replaced),
+        cmocka_unit_test(test_sign_tx_multi_path),
+        cmocka_unit_test(test_sign_tx_hash),
+        cmocka_unit_test(test_sign_tx_hashes),
+        cmocka_unit_test(test_sign_tx_hashes_dropped),
+        cmocka_unit_test(test_queue_tx),
+        cmocka_unit_test(test_queue_tx_invalid),
+        cmocka_unit_test(test_reset_ctx),
+        cmocka_unit_test(test_swap_sign_tx),
+        cmocka_unit_test(test_sign_tx_hash_disabled),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,227 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "stellar_api.h"
+#include "stellar_types.h"
+#include "stellar_vars.h"
+
+/* a fresh install: zeroed NVRAM */
+static int setup_store(void **state) {
+    (void) state;
+    memset(&N_state_pic, 0, sizeof(N_state_pic));
+    nv_load();
+    return 0;
+}
+
+static void set_hash_signing(uint8_t enabled) {
+    nv_write(&N_stellar_pstate.hashSigning, &enabled, 1);
+    nv_commit();
+}
+
+static nv_stats_t stats_since(const nv_stats_t *before) {
+    nv_stats_t delta = {
+        .commits = nv_stats.commits - before->commits,
+        .snapshots = nv_stats.snapshots - before->snapshots,
+        .writes = nv_stats.writes - before->writes,
+        .bytes = nv_stats.bytes - before->bytes,
+        .pages = nv_stats.pages - before->pages,
+        .commitNs = nv_stats.commitNs - before->commitNs,
+    };
+    return delta;
+}
+
+/* flash cost of an operation */
+static void report(const char *operation, const nv_stats_t *delta) {
+    print_message("%-20s %2u writes %4u bytes %2u pages %6llu ns/commit\n",
+                  operation,
+                  delta->writes,
+                  delta->bytes,
+                  delta->pages,
+                  (unsigned long long) (delta->commitNs / (delta->commits ? delta->commits : 1)));
+}
+
+void test_record_size(void **state) {
+    (void) state;
+    // two records per flash page
+    assert_int_equal(sizeof(nv_record_t), 32);
+}
+
+void test_init_single_write(void **state) {
+    (void) state;
+    uint8_t initialized = 0x01;
+    uint8_t disabled = 0x00;
+    nv_stats_t before = nv_stats;
+
+    // what stellar_nv_state_init() does on the first launch
+    nv_write(&N_stellar_pstate.initialized, &initialized, 1);
+    nv_write(&N_stellar_pstate.hashSigning, &disabled, 1);
+    nv_write(&N_stellar_pstate.pubkeyCaching, &disabled, 1);
+    nv_commit();
+    nv_stats_t delta = stats_since(&before);
+    report("first launch", &delta);
+    assert_int_equal(delta.writes, 1);
+    assert_int_equal(delta.bytes, sizeof(nv_record_t));
+
+    nv_load();
+    assert_int_equal(N_stellar_pstate.initialized, 1);
+
+    // unchanged values are not written again
+    before = nv_stats;
+    nv_write(&N_stellar_pstate.initialized, &initialized, 1);
+    nv_commit();
+    assert_int_equal(stats_since(&before).writes, 0);
+}
+
+void test_toggle_journal(void **state) {
+    (void) state;
+    nv_stats_t before = nv_stats;
+
+    // each toggle appends one record until the journal is full, then writes a snapshot
+    for (int i = 0; i < 3 * NV_JOURNAL_SIZE; i++) {
+        nv_stats_t toggle = nv_stats;
+        set_hash_signing(i % 2 == 0);
+        toggle = stats_since(&toggle);
+        assert_int_equal(toggle.writes, 1);
+        if (i == 0) {
+            report("hash signing toggle", &toggle);
+        }
+
+        nv_load();
+        assert_int_equal(N_stellar_pstate.hashSigning, i % 2 == 0);
+    }
+    nv_stats_t delta = stats_since(&before);
+    report("48 toggles", &delta);
+    assert_int_equal(delta.commits, 3 * NV_JOURNAL_SIZE);
+    assert_int_equal(delta.snapshots, 2);
+}
+
+void test_coalescing(void **state) {
+    (void) state;
+    nv_pubkey_entry_t entry;
+    nv_stats_t before = nv_stats;
+
+    // a setting and a cache entry: one append of NV_COMMIT_RECORDS records
+    memset(&entry, 0x5a, sizeof(entry));
+    nv_write(&N_stellar_pstate.pubkeyCaching, "\x01", 1);
+    nv_write(&N_stellar_pstate.pubkeyCache[0], &entry, sizeof(entry));
+    nv_commit();
+    nv_stats_t delta = stats_since(&before);
+    report("setting + key", &delta);
+    assert_int_equal(delta.writes, 1);
+    assert_int_equal(delta.snapshots, 0);
+    assert_int_equal(delta.bytes, NV_COMMIT_RECORDS * sizeof(nv_record_t));
+
+    // larger changes are written as a snapshot, still with one write
+    before = nv_stats;
+    nv_write(&N_stellar_pstate.pubkeyCache[1], &entry, sizeof(entry));
+    nv_write(&N_stellar_pstate.pubkeyCache[2], &entry, sizeof(entry));
+    nv_commit();
+    delta = stats_since(&before);
+    report("2 keys (snapshot)", &delta);
+    assert_int_equal(delta.writes, 1);
+    assert_int_equal(delta.snapshots, 1);
+    assert_int_equal(delta.bytes, sizeof(nv_snapshot_t));
+
+    memset(&N_stellar_pstate, 0, sizeof(N_stellar_pstate));
+    nv_load();
+    assert_int_equal(N_stellar_pstate.pubkeyCaching, 1);
+    assert_memory_equal(&N_stellar_pstate.pubkeyCache[0], &entry, sizeof(entry));
+    assert_memory_equal(&N_stellar_pstate.pubkeyCache[2], &entry, sizeof(entry));
+}
+
+void test_torn_commit(void **state) {
+    (void) state;
+    nv_pubkey_entry_t entry;
+
+    set_hash_signing(1);
+    set_hash_signing(0);
+
+    // the last record of a commit was not written: the commit is ignored
+    memset(&entry, 0x5a, sizeof(entry));
+    nv_write(&N_stellar_pstate.hashSigning, "\x01", 1);
+    nv_write(&N_stellar_pstate.pubkeyCache[0], &entry, sizeof(entry));
+    nv_commit();
+    memset(&N_state_pic.journal[2 + NV_COMMIT_RECORDS - 1], 0, sizeof(nv_record_t));
+    nv_load();
+    assert_int_equal(N_stellar_pstate.hashSigning, 0);
+    assert_int_equal(N_stellar_pstate.pubkeyCache[0].bip32Len, 0);
+
+    // the next commit takes the place of the torn one
+    set_hash_signing(1);
+    nv_load();
+    assert_int_equal(N_stellar_pstate.hashSigning, 1);
+    assert_int_equal(N_state_pic.journal[2].version, 3);
+
+    // a corrupted record ends the journal
+    N_state_pic.journal[1].data[0] ^= 1;
+    nv_load();
+    assert_int_equal(N_stellar_pstate.hashSigning, 1);
+    N_state_pic.journal[0].crc ^= 1;
+    nv_load();
+    assert_int_equal(N_stellar_pstate.hashSigning, 0);
+}
+
+void test_torn_snapshot(void **state) {
+    (void) state;
+    nv_snapshot_t previous;
+
+    // fill the journal, the next commit is a snapshot
+    for (int i = 0; i < NV_JOURNAL_SIZE; i++) {
+        set_hash_signing(i % 2 == 0);
+    }
+    assert_int_equal(N_stellar_pstate.hashSigning, 0);
+
+    // only the first page of the snapshot was written: the new version is over the old state
+    memcpy(&previous, &N_state_pic.snapshots[1], sizeof(previous));
+    nv_stats_t before = nv_stats;
+    set_hash_signing(1);
+    assert_int_equal(stats_since(&before).snapshots, 1);
+    assert_int_equal(N_state_pic.snapshots[1].version, NV_JOURNAL_SIZE + 1);
+    memcpy((uint8_t *) &N_state_pic.snapshots[1] + NVM_PAGE_SIZE,
+           (uint8_t *) &previous + NVM_PAGE_SIZE,
+           sizeof(previous) - NVM_PAGE_SIZE);
+
+    // the other slot and the journal that follows it are intact
+    nv_load();
+    assert_int_equal(N_stellar_pstate.initialized, 0);
+    assert_int_equal(N_stellar_pstate.hashSigning, 0);
+
+    // the commit is made again in the same slot
+    set_hash_signing(1);
+    nv_load();
+    assert_int_equal(N_stellar_pstate.hashSigning, 1);
+    assert_int_equal(N_state_pic.snapshots[1].version, NV_JOURNAL_SIZE + 1);
+
+    // the journal then follows the newest snapshot, the next one goes to the other slot
+    for (int i = 0; i < NV_JOURNAL_SIZE + 1; i++) {
+        set_hash_signing(i % 2 != 0);
+    }
+    nv_load();
+    assert_int_equal(N_stellar_pstate.hashSigning, 0);
+    assert_int_equal(N_state_pic.snapshots[0].version, 2 * NV_JOURNAL_SIZE + 2);
+
+    // erased flash: both slots and the journal read as 0xff, nothing is enabled
+    memset(&N_state_pic, 0xff, sizeof(N_state_pic));
+    nv_load();
+    assert_int_equal(N_stellar_pstate.initialized, 0);
+    assert_int_equal(N_stellar_pstate.hashSigning, 0);
+    set_hash_signing(1);
+    nv_load();
+    assert_int_equal(N_stellar_pstate.hashSigning, 1);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_record_size),
+        cmocka_unit_test_setup(test_init_single_write, setup_store),
+        cmocka_unit_test_setup(test_toggle_journal, setup_store),
+        cmocka_unit_test_setup(test_coalescing, setup_store),
+        cmocka_unit_test_setup(test_torn_commit, setup_store),
+        cmocka_unit_test_setup(test_torn_snapshot, setup_store),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
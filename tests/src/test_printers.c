@@ -17,10 +17,14 @@
 #include <setjmp.h>
 #include <stdarg.h>
 #include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <cmocka.h>
 
 #include "stellar_api.h"
+#include "reference.h"
 
 void test_print_amount(void **state) {
     (void) state;
@@ -38,6 +42,219 @@ void test_print_amount(void **state) {
     assert_string_equal(printed, "10.0000001 XLM");
     print_amount(100000001000000, &asset, NETWORK_TYPE_PUBLIC, printed, sizeof(printed));
     assert_string_equal(printed, "10000000.1 XLM");
+    print_amount(0, &asset, NETWORK_TYPE_PUBLIC, printed, sizeof(printed));
+    assert_string_equal(printed, "0 XLM");
+
+    const Asset usdc = {.type = ASSET_TYPE_CREDIT_ALPHANUM4, .assetCode = "USDC"};
+    print_amount(12345000, &usdc, NETWORK_TYPE_PUBLIC, printed, sizeof(printed));
+    assert_string_equal(printed, "1.2345 USDC");
+    const Asset token = {.type = ASSET_TYPE_CREDIT_ALPHANUM12, .assetCode = "LONGASSETCOD"};
+    print_amount(50000000, &token, NETWORK_TYPE_PUBLIC, printed, sizeof(printed));
+    assert_string_equal(printed, "5 LONGASSETCOD");
+
+    // the asset name is truncated to the output buffer, the amount is not
+    print_amount(50000000, &token, NETWORK_TYPE_PUBLIC, printed, 8);
+    assert_string_equal(printed, "5 LONGA");
+    assert_int_equal(print_amount(123456789, &token, NETWORK_TYPE_PUBLIC, printed, 11), 0);
+    assert_string_equal(printed, "12.3456789");
+    assert_int_equal(print_amount(123456789, &token, NETWORK_TYPE_PUBLIC, printed, 10), -1);
+}
+
+void test_strbuf(void **state) {
+    (void) state;
+
+    char out[8];
+    strbuf_t buf;
+
+    strbuf_init(&buf, out, sizeof(out));
+    strbuf_append(&buf, "abc");
+    strbuf_append_n(&buf, "defgh", 2);
+    assert_string_equal(out, "abcde");
+    assert_int_equal(buf.len, 5);
+    assert_false(buf.truncated);
+    strbuf_append(&buf, "fghij");
+    assert_string_equal(out, "abcdefg");
+    assert_int_equal(buf.len, 7);
+    assert_true(buf.truncated);
+
+    strbuf_init(&buf, out, 0);
+    strbuf_append(&buf, "a");
+    assert_true(buf.truncated);
+}
+
+void test_print_flags(void **state) {
+    (void) state;
+
+    char out[89];
+    strbuf_t buf;
+
+    strbuf_init(&buf, out, sizeof(out));
+    print_flags(0x07, &buf);
+    assert_string_equal(out, "Auth required, Auth revocable, Auth immutable");
+    assert_int_equal(buf.len, strlen(out));
+
+    strbuf_init(&buf, out, sizeof(out));
+    print_flags(0x04, &buf);
+    assert_string_equal(out, "Auth immutable");
+
+    strbuf_init(&buf, out, 20);
+    print_flags(0x03, &buf);
+    assert_string_equal(out, "Auth required, Auth");
+    assert_true(buf.truncated);
+
+    const Asset asset = {.type = ASSET_TYPE_CREDIT_ALPHANUM4,
+                         .assetCode = "USD",
+                         .issuer = (const uint8_t *) "\x9a\x22\x25\x00\xcf\x47\xb0\x3d"
+                                                     "\x05\xed\xec\x04\xed\x32\x94\xce"
+                                                     "\xce\x1d\xe7\x27\xcc\xad\xb4\x01"
+                                                     "\xf4\x7d\x6b\x4b\x23\x0e\x81\xa0"};
+    strbuf_init(&buf, out, sizeof(out));
+    print_asset_t(&asset, NETWORK_TYPE_PUBLIC, &buf);
+    assert_string_equal(out, "USD@GCN..BQ5B");
+}
+
+void test_strbuf_append_numbers(void **state) {
+    (void) state;
+
+    char out[24];
+    strbuf_t buf;
+    const Asset usdc = {.type = ASSET_TYPE_CREDIT_ALPHANUM4, .assetCode = "USDC"};
+    const Price price = {.n = 1, .d = 3};
+
+    strbuf_init(&buf, out, sizeof(out));
+    strbuf_append_amount(&buf, 12345000, &usdc, NETWORK_TYPE_PUBLIC);
+    assert_string_equal(out, "1.2345 USDC");
+    assert_int_equal(buf.len, strlen(out));
+
+    strbuf_init(&buf, out, sizeof(out));
+    assert_int_equal(strbuf_append_price(&buf, &price, NULL, NETWORK_TYPE_PUBLIC, 3), 0);
+    assert_string_equal(out, "0.3333333");
+    assert_int_equal(buf.len, strlen(out));
+    const Price zero = {.n = 1, .d = 0};
+    assert_int_equal(strbuf_append_price(&buf, &zero, NULL, NETWORK_TYPE_PUBLIC, 3), -1);
+    assert_string_equal(out, "0.3333333");
+
+    strbuf_init(&buf, out, sizeof(out));
+    strbuf_append_int(&buf, INT64_MIN);
+    assert_string_equal(out, "-9223372036854775808");
+    strbuf_append(&buf, "/");
+    strbuf_append_uint(&buf, 42);
+    assert_string_equal(out, "-9223372036854775808/42");
+    assert_false(buf.truncated);
+
+    // the digits that fit are kept and the truncation is reported
+    strbuf_init(&buf, out, 8);
+    strbuf_append_amount(&buf, 123456789, &usdc, NETWORK_TYPE_PUBLIC);
+    assert_string_equal(out, "12.3456");
+    assert_true(buf.truncated);
+    strbuf_init(&buf, out, 4);
+    strbuf_append_uint(&buf, 12345);
+    assert_string_equal(out, "123");
+    assert_true(buf.truncated);
+}
+
+void test_print_decimal(void **state) {
+    (void) state;
+
+    char printed[24];
+
+    assert_int_equal(print_decimal(12345, 2, printed, sizeof(printed)), 6);
+    assert_string_equal(printed, "123.45");
+    assert_int_equal(print_decimal(100, 2, printed, sizeof(printed)), 1);
+    assert_string_equal(printed, "1");
+    assert_int_equal(print_decimal(5, 3, printed, sizeof(printed)), 5);
+    assert_string_equal(printed, "0.005");
+    assert_int_equal(print_decimal(120, 0, printed, sizeof(printed)), 3);
+    assert_string_equal(printed, "120");
+    assert_int_equal(print_decimal(0, 7, printed, sizeof(printed)), 1);
+    assert_string_equal(printed, "0");
+    assert_int_equal(print_decimal(UINT64_MAX, 7, printed, sizeof(printed)), 21);
+    assert_string_equal(printed, "1844674407370.9551615");
+    assert_int_equal(print_decimal(UINT64_MAX, 19, printed, sizeof(printed)), 21);
+    assert_string_equal(printed, "1.8446744073709551615");
+    assert_int_equal(print_decimal(1, 20, printed, sizeof(printed)), 22);
+    assert_string_equal(printed, "0.00000000000000000001");
+    assert_int_equal(print_decimal(123, 2, printed, 4), -1);
+}
+
+void test_print_price(void **state) {
+    (void) state;
+
+    char printed[32];
+    const Asset asset = {.type = ASSET_TYPE_NATIVE};
+    const Price prices[] = {
+        {5, 3}, {1, 3}, {400, 2}, {1, 4}, {0, 7}, {1, 30000000}, {2147483647, 1}, {1, 2147483647}};
+    const char *expected[] = {"1.6666666",
+                              "0.3333333",
+                              "200",
+                              "0.25",
+                              "0",
+                              "0.00000003333333",
+                              "2147483647",
+                              "0.0000000004656612"};
+
+    for (size_t i = 0; i < sizeof(prices) / sizeof(prices[0]); i++) {
+        assert_int_equal(print_price(&prices[i],
+                                     NULL,
+                                     NETWORK_TYPE_PUBLIC,
+                                     PRICE_SIGNIFICANT_DIGITS,
+                                     printed,
+                                     sizeof(printed)),
+                         0);
+        assert_string_equal(printed, expected[i]);
+    }
+
+    assert_int_equal(
+        print_price(&prices[0], &asset, NETWORK_TYPE_PUBLIC, 3, printed, sizeof(printed)),
+        0);
+    assert_string_equal(printed, "1.6666666 XLM");
+    assert_int_equal(
+        print_price(&prices[5], NULL, NETWORK_TYPE_PUBLIC, 3, printed, sizeof(printed)),
+        0);
+    assert_string_equal(printed, "0.0000000333");
+
+    // output buffer too small
+    assert_int_equal(print_price(&prices[6], NULL, NETWORK_TYPE_PUBLIC, 7, printed, 10), -1);
+}
+
+/* the fixed 7 decimals price formatting which print_price replaces */
+static void print_price_fixed_point(const Price *price, char *out, size_t out_len) {
+    uint64_t fixed = ((uint64_t) price->n * 10000000) / price->d;
+    print_amount(fixed, NULL, NETWORK_TYPE_PUBLIC, out, out_len);
+}
+
+void test_print_price_truncation(void **state) {
+    (void) state;
+
+    char printed[32];
+    char expected[32];
+
+    srand(0);
+    for (int i = 0; i < 100000; i++) {
+        Price price = {rand() >> (rand() % 31), (rand() >> (rand() % 31)) + 1};
+        print_price_fixed_point(&price, expected, sizeof(expected));
+        assert_int_equal(print_price(&price,
+                                     NULL,
+                                     NETWORK_TYPE_PUBLIC,
+                                     PRICE_SIGNIFICANT_DIGITS,
+                                     printed,
+                                     sizeof(printed)),
+                         0);
+
+        // the exact price truncated to 7 decimals is the former output
+        char *dot = strchr(printed, '.');
+        if (dot != NULL && strlen(dot) > 8) {
+            dot[8] = '\0';
+        }
+        size_t len = strlen(printed);
+        while (dot != NULL && printed[len - 1] == '0') {
+            printed[--len] = '\0';
+        }
+        if (printed[len - 1] == '.') {
+            printed[--len] = '\0';
+        }
+        assert_string_equal(printed, expected);
+    }
 }
 
 void test_print_uint(void **state) {
@@ -94,15 +311,385 @@ void test_print_summary(void **state) {
     assert_string_equal(summary, "GADFVW..LEQN2I");
 }
 
+void test_crc16(void **state) {
+    (void) state;
+
+    uint8_t data[64];
+
+    // XModem check value
+    assert_int_equal(crc16((const uint8_t *) "123456789", 9), 0x31c3);
+    assert_int_equal(crc16(data, 0), 0);
+
+    srand(0);
+    for (int i = 0; i < 10000; i++) {
+        size_t length = rand() % (sizeof(data) + 1);
+        for (size_t j = 0; j < length; j++) {
+            data[j] = rand();
+        }
+        uint16_t expected = crc16_bitwise(data, length);
+        assert_int_equal(crc16_nibble(data, length), expected);
+        assert_int_equal(crc16_byte(data, length), expected);
+        assert_int_equal(crc16_slice4(data, length), expected);
+        assert_int_equal(crc16(data, length), expected);
+    }
+}
+
+void test_encode_key(void **state) {
+    (void) state;
+
+    uint8_t raw[STRKEY_RAW_SIZE];
+    char expected[STRKEY_SIZE + 1];
+    char encoded[STRKEY_SIZE + 1];
+
+    srand(0);
+    for (int i = 0; i < 10000; i++) {
+        for (int j = 1; j <= 32; j++) {
+            raw[j] = rand();
+        }
+        switch (i % 3) {
+            case 0:
+                raw[0] = STRKEY_VERSION_ACCOUNT_ID;
+                encode_public_key(raw + 1, encoded);
+                break;
+            case 1:
+                raw[0] = STRKEY_VERSION_PRE_AUTH_TX;
+                encode_pre_auth_key(raw + 1, encoded);
+                break;
+            default:
+                raw[0] = STRKEY_VERSION_HASH_X;
+                encode_hash_x_key(raw + 1, encoded);
+                break;
+        }
+        uint16_t crc = crc16_bitwise(raw, 33);
+        raw[33] = crc;
+        raw[34] = crc >> 8;
+        assert_int_equal(base32_encode(raw, STRKEY_RAW_SIZE, expected, sizeof(expected)),
+                         STRKEY_SIZE);
+        assert_string_equal(encoded, expected);
+    }
+}
+
+void test_encode_public_keys_bulk(void **state) {
+    (void) state;
+
+    static uint8_t keys[100][32];
+    static char expected[100][57];
+    static char encoded[100][57];
+
+    srand(0);
+    for (size_t i = 0; i < 100; i++) {
+        for (int j = 0; j < 32; j++) {
+            keys[i][j] = rand();
+        }
+        encode_public_key(keys[i], expected[i]);
+    }
+    // every remainder of the 16 keys blocks
+    for (size_t n = 0; n <= 100; n += 7) {
+        memset(encoded, 0xFF, sizeof(encoded));
+        encode_public_keys_bulk(keys, n, encoded);
+        for (size_t i = 0; i < n; i++) {
+            assert_string_equal(encoded[i], expected[i]);
+        }
+    }
+#ifdef HAVE_HOST_SIMD
+    if (__builtin_cpu_supports("avx2")) {
+        assert_int_equal(encode_public_keys_avx2(keys, 100, encoded), 96);
+    }
+#endif
+}
+
+void test_decode_strkey(void **state) {
+    (void) state;
+
+    uint8_t key[32];
+    uint8_t decoded[32];
+    char encoded[STRKEY_SIZE + 1];
+
+    srand(0);
+    for (int i = 0; i < 10000; i++) {
+        for (int j = 0; j < 32; j++) {
+            key[j] = rand();
+        }
+        encode_pre_auth_key(key, encoded);
+        assert_true(decode_strkey(encoded, STRKEY_VERSION_PRE_AUTH_TX, decoded));
+        assert_memory_equal(decoded, key, sizeof(key));
+        assert_false(decode_strkey(encoded, STRKEY_VERSION_ACCOUNT_ID, decoded));
+    }
+
+    const char *address = "GCNCEJIAZ5D3APIF5XWAJ3JSSTHM4HPHE7GK3NAB6R6WWSZDB2A2BQ5B";
+    assert_true(decode_strkey(address, STRKEY_VERSION_ACCOUNT_ID, decoded));
+    assert_memory_equal(decoded,
+                        "\x9a\x22\x25\x00\xcf\x47\xb0\x3d\x05\xed\xec\x04\xed\x32\x94\xce"
+                        "\xce\x1d\xe7\x27\xcc\xad\xb4\x01\xf4\x7d\x6b\x4b\x23\x0e\x81\xa0",
+                        32);
+
+    // checksum mismatch
+    strcpy(encoded, address);
+    encoded[10] = encoded[10] == 'A' ? 'B' : 'A';
+    assert_false(decode_strkey(encoded, STRKEY_VERSION_ACCOUNT_ID, decoded));
+    // characters outside the alphabet
+    strcpy(encoded, address);
+    encoded[20] = 'a';
+    assert_false(decode_strkey(encoded, STRKEY_VERSION_ACCOUNT_ID, decoded));
+    encoded[20] = '1';
+    assert_false(decode_strkey(encoded, STRKEY_VERSION_ACCOUNT_ID, decoded));
+    // wrong length
+    assert_false(decode_strkey("GCNCEJIAZ5D3APIF5XWAJ3JSSTHM4HPHE7GK3NAB6R6WWSZDB2A2BQ5",
+                               STRKEY_VERSION_ACCOUNT_ID,
+                               decoded));
+    assert_false(decode_strkey("GCNCEJIAZ5D3APIF5XWAJ3JSSTHM4HPHE7GK3NAB6R6WWSZDB2A2BQ5BA",
+                               STRKEY_VERSION_ACCOUNT_ID,
+                               decoded));
+    assert_false(decode_strkey("", STRKEY_VERSION_ACCOUNT_ID, decoded));
+}
+
+void test_decode_strkeys_bulk(void **state) {
+    (void) state;
+
+    static char addresses[200][57];
+    static uint8_t keys[200][32];
+    static uint8_t decoded[200][32];
+    uint8_t valid[200 / 8];
+    uint8_t key[32];
+
+    srand(0);
+    for (size_t i = 0; i < 200; i++) {
+        for (int j = 0; j < 32; j++) {
+            key[j] = rand();
+        }
+        if (rand() % 8 == 0) {
+            encode_pre_auth_key(key, addresses[i]);
+        } else {
+            encode_public_key(key, addresses[i]);
+        }
+        switch (rand() % 8) {
+            case 0:
+                // checksum or alphabet error
+                addresses[i][rand() % STRKEY_SIZE] = "AZ27a1=\xff"[rand() % 8];
+                break;
+            case 1:
+                // too short
+                addresses[i][rand() % STRKEY_SIZE] = '\0';
+                break;
+            case 2:
+                // too long
+                addresses[i][STRKEY_SIZE] = 'A';
+                break;
+            default:
+                break;
+        }
+    }
+    // scalar reference: one decode_strkey per entry
+    for (size_t n = 0; n <= 200; n += 13) {
+        memset(decoded, 0xFF, sizeof(decoded));
+        memset(valid, 0xFF, sizeof(valid));
+        decode_strkeys_bulk(addresses, n, STRKEY_VERSION_ACCOUNT_ID, decoded, valid);
+        for (size_t i = 0; i < n; i++) {
+            bool ok = decode_strkey(addresses[i], STRKEY_VERSION_ACCOUNT_ID, keys[i]);
+            assert_int_equal((valid[i / 8] >> (i % 8)) & 1, ok);
+            if (ok) {
+                assert_memory_equal(decoded[i], keys[i], 32);
+            } else {
+                memset(key, 0, sizeof(key));
+                assert_memory_equal(decoded[i], key, 32);
+            }
+        }
+        // padding bits of the last byte
+        for (size_t i = n; i < (n + 7) / 8 * 8; i++) {
+            assert_int_equal((valid[i / 8] >> (i % 8)) & 1, 0);
+        }
+    }
+}
+
+/* random value with a random number of significant bits */
+static uint64_t random_uint64(void) {
+    uint64_t value = (uint64_t) rand() << 62 ^ (uint64_t) rand() << 31 ^ rand();
+    return value >> (rand() % 64);
+}
+
+void test_print_uint_random(void **state) {
+    (void) state;
+
+    const uint64_t edges[] = {0,
+                              1,
+                              9,
+                              10,
+                              99,
+                              100,
+                              999999999,
+                              1000000000,
+                              999999999999999999,
+                              1000000000000000000,
+                              UINT64_MAX};
+    char expected[24];
+    char printed[24];
+
+    for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+        print_uint_divide(edges[i], expected, sizeof(expected));
+        assert_int_equal(print_uint(edges[i], printed, sizeof(printed)), 0);
+        assert_string_equal(printed, expected);
+    }
+    assert_int_equal(print_int(INT64_MIN, printed, sizeof(printed)), 0);
+    assert_string_equal(printed, "-9223372036854775808");
+    assert_int_equal(print_uint(UINT64_MAX, printed, 20), -1);
+    assert_int_equal(print_uint(12345, printed, 6), 0);
+    assert_int_equal(print_uint(12345, printed, 5), -1);
+
+    srand(0);
+    for (int i = 0; i < 100000; i++) {
+        uint64_t value = random_uint64();
+        print_uint_divide(value, expected, sizeof(expected));
+        assert_int_equal(print_uint(value, printed, sizeof(printed)), 0);
+        assert_string_equal(printed, expected);
+
+        if (value <= INT64_MAX) {
+            assert_int_equal(print_int(-(int64_t) value, printed, sizeof(printed)), 0);
+            assert_string_equal(printed + (value != 0), expected);
+
+            print_amount_divide(value, expected);
+            assert_int_equal(print_amount(value, NULL, 0, printed, sizeof(printed)), 0);
+            assert_string_equal(printed, expected);
+        }
+    }
+}
+
+void test_print_strkey(void **state) {
+    (void) state;
+
+    const uint8_t versions[] = {
+        STRKEY_VERSION_ACCOUNT_ID, STRKEY_VERSION_PRE_AUTH_TX, STRKEY_VERSION_HASH_X};
+    uint8_t key[32];
+    char full[57];
+    char expected[57];
+    char summary[57];
+
+    srand(0);
+    for (int i = 0; i < 10000; i++) {
+        for (int j = 0; j < 32; j++) {
+            key[j] = rand();
+        }
+        uint8_t version = versions[i % 3];
+        uint8_t numCharsL = 1 + rand() % 27;
+        uint8_t numCharsR = rand() % 27;
+
+        switch (version) {
+            case STRKEY_VERSION_ACCOUNT_ID:
+                encode_public_key(key, full);
+                break;
+            case STRKEY_VERSION_PRE_AUTH_TX:
+                encode_pre_auth_key(key, full);
+                break;
+            default:
+                encode_hash_x_key(key, full);
+                break;
+        }
+        memset(expected, 0, sizeof(expected));
+        print_summary(full, expected, numCharsL, numCharsR);
+
+        print_strkey(key, version, summary, numCharsL, numCharsR);
+        assert_string_equal(summary, expected);
+
+        // same output when served from the warm cache
+        strkey_cache_warm(key, version);
+        print_strkey(key, version, summary, numCharsL, numCharsR);
+        assert_string_equal(summary, expected);
+    }
+    strkey_cache_clear();
+
+    print_public_key(key, summary, 0, 0);
+    encode_public_key(key, full);
+    assert_string_equal(summary, full);
+}
+
+void test_pubkey_cache(void **state) {
+    (void) state;
+
+    const uint32_t path[3] = {0x8000002C, 0x80000094, 0x80000000};
+    const uint32_t other[3] = {0x8000002C, 0x80000094, 0x80000001};
+    uint8_t key[32];
+    uint8_t cached[32];
+
+    pubkey_cache_clear();
+    assert_false(pubkey_cache_lookup(path, 3, cached));
+
+    memset(key, 0xA5, sizeof(key));
+    pubkey_cache_store(path, 3, key);
+    assert_true(pubkey_cache_lookup(path, 3, cached));
+    assert_memory_equal(cached, key, sizeof(key));
+
+    // a prefix or a sibling of a cached path is a different key
+    assert_false(pubkey_cache_lookup(path, 2, cached));
+    assert_false(pubkey_cache_lookup(other, 3, cached));
+
+    // storing a path again updates its entry in place
+    key[0] = 0x5A;
+    pubkey_cache_store(path, 3, key);
+    assert_true(pubkey_cache_lookup(path, 3, cached));
+    assert_int_equal(cached[0], 0x5A);
+
+    // oldest entries are evicted first
+    uint32_t account[3] = {0x8000002C, 0x80000094, 0x80000000};
+    for (uint32_t i = 1; i <= PUBKEY_CACHE_SIZE; i++) {
+        account[2] = 0x80000000 | i;
+        key[0] = (uint8_t) i;
+        pubkey_cache_store(account, 3, key);
+    }
+    assert_false(pubkey_cache_lookup(path, 3, cached));
+    assert_true(pubkey_cache_lookup(account, 3, cached));
+    assert_int_equal(cached[0], PUBKEY_CACHE_SIZE);
+
+    assert_false(pubkey_cache_lookup(path, MAX_BIP32_LEN + 1, cached));
+
+    pubkey_cache_clear();
+    assert_false(pubkey_cache_lookup(account, 3, cached));
+}
+
 void test_print_binary(void **state) {
     (void) state;
 
     const uint8_t binary[32] = {0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15,
                                 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31};
-    char hex[16];
+    char hex[67];
 
     print_binary_summary(binary, hex, 32);
     assert_string_equal(hex, "0x000102..1D1E1F");
+    print_binary_summary(binary + 24, hex, 8);
+    assert_string_equal(hex, "0x18191A1B1C1D1E1F");
+    print_binary(binary, hex, 32);
+    assert_string_equal(hex, "0x000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F");
+}
+
+void test_print_hex(void **state) {
+    (void) state;
+
+    uint8_t data[200];
+    char expected[2 * sizeof(data) + 1];
+    char hex[2 * sizeof(data) + 1];
+
+    srand(0);
+    for (int i = 0; i < 10000; i++) {
+        size_t len = rand() % (sizeof(data) + 1);
+        for (size_t j = 0; j < len; j++) {
+            data[j] = rand();
+            sprintf(expected + 2 * j, "%02X", data[j]);
+        }
+        expected[2 * len] = '\0';
+
+        print_hex(data, len, hex);
+        assert_string_equal(hex, expected);
+#ifdef HAVE_HOST_SIMD
+        if (__builtin_cpu_supports("ssse3")) {
+            size_t done = print_hex_ssse3(data, len, hex);
+            assert_int_equal(done, len / 16 * 16);
+            assert_memory_equal(hex, expected, 2 * done);
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            size_t done = print_hex_avx2(data, len, hex);
+            assert_int_equal(done, len / 16 * 16);
+            assert_memory_equal(hex, expected, 2 * done);
+        }
+#endif
+    }
 }
 
 void test_base64_encode(void **state) {
@@ -111,16 +698,66 @@ void test_base64_encode(void **state) {
     char base64[20];
     base64_encode((uint8_t *) "starlight", 9, base64);
     assert_string_equal(base64, "c3RhcmxpZ2h0");
+    base64_encode((uint8_t *) "star", 4, base64);
+    assert_string_equal(base64, "c3Rhcg==");
+    base64_encode((uint8_t *) "stars", 5, base64);
+    assert_string_equal(base64, "c3RhcnM=");
+    base64_encode((uint8_t *) "", 0, base64);
+    assert_string_equal(base64, "");
+}
+
+void test_print_base64_summary(void **state) {
+    (void) state;
+
+    uint8_t data[64];
+    char full[89];
+    char expected[89];
+    char summary[89];
+
+    srand(0);
+    for (int i = 0; i < 10000; i++) {
+        size_t len = 1 + rand() % sizeof(data);
+        for (size_t j = 0; j < len; j++) {
+            data[j] = rand();
+        }
+        uint8_t numCharsL = rand() % 16;
+        uint8_t numCharsR = rand() % 16;
+
+        base64_encode_reference(data, len, full);
+        base64_encode(data, len, summary);
+        assert_string_equal(summary, full);
+
+        memset(expected, 0, sizeof(expected));
+        print_summary(full, expected, numCharsL, numCharsR);
+        print_base64_summary(data, len, summary, numCharsL, numCharsR);
+        assert_string_equal(summary, expected);
+    }
 }
 
 int main() {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_print_amount),
+        cmocka_unit_test(test_print_decimal),
+        cmocka_unit_test(test_strbuf),
+        cmocka_unit_test(test_print_flags),
+        cmocka_unit_test(test_strbuf_append_numbers),
+        cmocka_unit_test(test_print_price),
+        cmocka_unit_test(test_print_price_truncation),
         cmocka_unit_test(test_print_uint),
         cmocka_unit_test(test_print_int),
         cmocka_unit_test(test_print_summary),
+        cmocka_unit_test(test_crc16),
+        cmocka_unit_test(test_encode_key),
+        cmocka_unit_test(test_encode_public_keys_bulk),
+        cmocka_unit_test(test_decode_strkey),
+        cmocka_unit_test(test_decode_strkeys_bulk),
+        cmocka_unit_test(test_print_uint_random),
+        cmocka_unit_test(test_print_strkey),
+        cmocka_unit_test(test_pubkey_cache),
         cmocka_unit_test(test_print_binary),
+        cmocka_unit_test(test_print_hex),
         cmocka_unit_test(test_base64_encode),
+        cmocka_unit_test(test_print_base64_summary),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
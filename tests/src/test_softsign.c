@@ -0,0 +1,167 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+
+#include "softsign.h"
+
+#define WORKERS 4
+#define COPIES  8
+
+static const char *testcases[] = {
+    "../testcases/txMultiOp",
+    "../testcases/txSimple",
+    "../testcases/txMemoText",
+    "../testcases/txTimeBounds",
+    "../testcases/txOpSource",
+    "../testcases/txPathPayment",
+    "../testcases/txSetAllOptions",
+    "../testcases/txManageBuyOffer",
+};
+
+#define TESTCASE_COUNT (sizeof(testcases) / sizeof(testcases[0]))
+#define ENVELOPE_COUNT (TESTCASE_COUNT * COPIES)
+
+static const uint8_t PRIVATE_KEY[32] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+
+static uint8_t raws[TESTCASE_COUNT][MAX_RAW_TX];
+static char expected[TESTCASE_COUNT][4096];
+static char reviews[ENVELOPE_COUNT][4096];
+
+/* each envelope is reviewed by a single worker, which owns reviews[index] */
+static void record_screen(void *arg, size_t index, const char *caption, const char *value) {
+    (void) arg;
+    size_t length = strlen(reviews[index]);
+    snprintf(reviews[index] + length, sizeof(reviews[index]) - length, "%s; %s\n", caption, value);
+}
+
+static size_t read_file(const char *prefix, const char *ext, void *buf, size_t size) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s%s", prefix, ext);
+    FILE *f = fopen(path, "rb");
+    assert_non_null(f);
+    size_t length = fread(buf, 1, size, f);
+    fclose(f);
+    return length;
+}
+
+static void verify_signature(const uint8_t *hash, const uint8_t *signature) {
+    uint8_t publicKey[32];
+    size_t length = sizeof(publicKey);
+    EVP_PKEY *key = EVP_PKEY_new_raw_private_key(EVP_PKEY_ED25519, NULL, PRIVATE_KEY, 32);
+    assert_non_null(key);
+    assert_int_equal(EVP_PKEY_get_raw_public_key(key, publicKey, &length), 1);
+    EVP_PKEY_free(key);
+
+    key = EVP_PKEY_new_raw_public_key(EVP_PKEY_ED25519, NULL, publicKey, 32);
+    EVP_MD_CTX *md = EVP_MD_CTX_new();
+    assert_int_equal(EVP_DigestVerifyInit(md, NULL, NULL, NULL, key), 1);
+    assert_int_equal(EVP_DigestVerify(md, signature, 64, hash, HASH_SIZE), 1);
+    EVP_MD_CTX_free(md);
+    EVP_PKEY_free(key);
+}
+
+void test_batch(void **state) {
+    (void) state;
+    static softsign_envelope_t envelopes[ENVELOPE_COUNT];
+    static softsign_result_t results[ENVELOPE_COUNT];
+    uint8_t hash[HASH_SIZE];
+
+    for (size_t i = 0; i < TESTCASE_COUNT; i++) {
+        size_t length = read_file(testcases[i], ".raw", raws[i], sizeof(raws[i]));
+        size_t end = read_file(testcases[i], ".txt", expected[i], sizeof(expected[i]) - 2);
+        if (expected[i][end - 1] != '\n') {
+            expected[i][end] = '\n';
+        }
+        for (size_t j = 0; j < COPIES; j++) {
+            envelopes[j * TESTCASE_COUNT + i].raw = raws[i];
+            envelopes[j * TESTCASE_COUNT + i].rawLength = length;
+        }
+    }
+
+    softsign_pool_t *pool = softsign_pool_new(PRIVATE_KEY, WORKERS);
+    assert_non_null(pool);
+    // the workers keep their contexts from one batch to the next
+    for (int batch = 0; batch < 2; batch++) {
+        memset(reviews, 0, sizeof(reviews));
+        softsign_batch(pool, envelopes, results, ENVELOPE_COUNT, record_screen, NULL);
+
+        for (size_t i = 0; i < ENVELOPE_COUNT; i++) {
+            assert_int_equal(results[i].sw, 0x9000);
+            assert_string_equal(reviews[i], expected[i % TESTCASE_COUNT]);
+            SHA256(envelopes[i].raw, envelopes[i].rawLength, hash);
+            assert_memory_equal(results[i].hash, hash, HASH_SIZE);
+            verify_signature(hash, results[i].signature);
+        }
+    }
+    softsign_pool_free(pool);
+}
+
+void test_invalid_envelopes(void **state) {
+    (void) state;
+    static uint8_t raw[MAX_RAW_TX + 1];
+    softsign_envelope_t envelopes[2];
+    softsign_result_t results[2];
+
+    size_t length = read_file(testcases[1], ".raw", raw, sizeof(raw));
+    envelopes[0].raw = raw;
+    envelopes[0].rawLength = length - 8;  // truncated
+    envelopes[1].raw = raw;
+    envelopes[1].rawLength = sizeof(raw);
+
+    softsign_pool_t *pool = softsign_pool_new(PRIVATE_KEY, 2);
+    assert_non_null(pool);
+    softsign_batch(pool, envelopes, results, 2, NULL, NULL);
+    softsign_pool_free(pool);
+
+    assert_int_equal(results[0].sw, 0x6800);
+    assert_int_equal(results[1].sw, 0x6700);
+}
+
+/* raises the formatter's stack overflow on the fee screen of the envelope at index *arg */
+static void throw_on_fee(void *arg, size_t index, const char *caption, const char *value) {
+    (void) value;
+    if (index == *(size_t *) arg && strcmp(caption, "Fee") == 0) {
+        THROW(0x6124);
+    }
+}
+
+void test_throw(void **state) {
+    (void) state;
+    softsign_envelope_t envelopes[WORKERS];
+    softsign_result_t results[WORKERS];
+    size_t throwing = 1;
+
+    size_t length = read_file(testcases[1], ".raw", raws[1], sizeof(raws[1]));
+    for (size_t i = 0; i < WORKERS; i++) {
+        envelopes[i].raw = raws[1];
+        envelopes[i].rawLength = length;
+    }
+
+    // a THROW ends the review of its envelope only, and the worker goes on with the next ones
+    softsign_pool_t *pool = softsign_pool_new(PRIVATE_KEY, 1);
+    assert_non_null(pool);
+    for (int batch = 0; batch < 2; batch++) {
+        softsign_batch(pool, envelopes, results, WORKERS, throw_on_fee, &throwing);
+        for (size_t i = 0; i < WORKERS; i++) {
+            assert_int_equal(results[i].sw, i == throwing ? 0x6800 : 0x9000);
+        }
+        throwing = WORKERS;
+    }
+    softsign_pool_free(pool);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_batch),
+        cmocka_unit_test(test_invalid_envelopes),
+        cmocka_unit_test(test_throw),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
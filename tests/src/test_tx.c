@@ -8,6 +8,7 @@
 
 #include "stellar_api.h"
 #include "stellar_format.h"
+#include "stellar_jobs.h"
 
 stellar_context_t ctx;
 tx_context_t tx_ctx;
@@ -65,12 +66,16 @@ static void check_transaction_results(const char *filename) {
     char path[1024];
     char line[4096];
     uint8_t opCount = ctx.req.tx.opCount;
+    uint16_t screenCount;
+    uint16_t screens = 0;
     current_data_index = 0;
     get_result_filename(filename, path, sizeof(path));
 
     FILE *fp = fopen(path, "r");
     assert_non_null(fp);
 
+    assert_true(get_transaction_screen_count(&ctx.req.tx, &screenCount));
+
     set_state_data(true);
 
     while ((opCount != 0 && current_data_index < opCount) ||
@@ -91,9 +96,13 @@ static void check_transaction_results(const char *filename) {
         }
         assert_string_equal(expected_title, detailCaption);
         assert_string_equal(expected_value, detailValue);
+        screens++;
 
         formatter_index++;
 
+        // background jobs run between screens
+        jobs_run_slice();
+
         if (formatter_stack[formatter_index] != NULL) {
             set_state_data(true);
         }
@@ -101,10 +110,14 @@ static void check_transaction_results(const char *filename) {
     assert_int_equal(fgets(line, sizeof(line), fp), 0);
     assert_int_equal(feof(fp), 1);
     fclose(fp);
+
+    assert_int_equal(screens, screenCount);
 }
 
 static void test_tx(const char *filename) {
     memset(&ctx.req.tx, 0, sizeof(ctx.req.tx));
+    jobs_clear();
+    strkey_cache_clear();
 
     load_transaction_data(filename, &ctx.req.tx);
 
@@ -124,9 +137,79 @@ void test_transactions(void **state) {
     }
 }
 
+void test_multi_path_signing_keys(void **state) {
+    (void) state;
+    const char *paths[] = {"44'/148'/0'", "44'/148'/1'", "44'/148'/2147483647'"};
+
+    memset(&ctx.req.tx, 0, sizeof(ctx.req.tx));
+    jobs_clear();
+    strkey_cache_clear();
+    load_transaction_data("../testcases/txSimple.raw", &ctx.req.tx);
+    ctx.req.tx.pathCount = 3;
+    ctx.req.tx.multiPath = true;
+    for (uint8_t i = 0; i < 3; i++) {
+        ctx.req.tx.bip32Len[i] = 3;
+        ctx.req.tx.bip32[i][0] = 0x8000002c;
+        ctx.req.tx.bip32[i][1] = 0x80000094;
+    }
+    ctx.req.tx.bip32[0][2] = 0x80000000;
+    ctx.req.tx.bip32[1][2] = 0x80000001;
+    ctx.req.tx.bip32[2][2] = 0xffffffff;
+    ctx.state = STATE_APPROVE_TX;
+    assert_true(parse_tx_xdr(ctx.req.tx.raw, ctx.req.tx.rawLength, &ctx.req.tx));
+
+    uint16_t screenCount;
+    uint16_t screens = 1;
+    assert_true(get_transaction_screen_count(&ctx.req.tx, &screenCount));
+
+    // a screen per signing key follows the transaction source, on the last screens
+    current_data_index = 0;
+    set_state_data(true);
+    for (formatter_index++; formatter_stack[formatter_index] != NULL; formatter_index++) {
+        set_state_data(true);
+        screens++;
+        if (screens > screenCount - 3) {
+            assert_string_equal(detailCaption, "Signing Key");
+            assert_string_equal(detailValue, paths[screens - (screenCount - 2)]);
+        }
+    }
+    assert_int_equal(screens, screenCount);
+}
+
+void test_batch_hash_screens(void **state) {
+    (void) state;
+
+    memset(&ctx.req.tx, 0, sizeof(ctx.req.tx));
+    memset(ctx.req.tx.hash, 0xAB, HASH_SIZE);
+    ctx.req.tx.hashCount = 12;
+    ctx.state = STATE_APPROVE_TX_HASHES;
+
+    const char *expected[TX_HASHES_SCREEN_COUNT][2] = {
+        {"WARNING", "No details available"},
+        {"Hashes", "12"},
+        {"Digest", "ABABABABABABABABABABABABABABABABABABABABABABABABABABABABABABABAB"},
+    };
+    formatter_index = 0;
+    MEMCLEAR(formatter_stack);
+    current_data_index = 0;
+    set_state_data(true);
+    for (uint8_t i = 0; i < TX_HASHES_SCREEN_COUNT; i++) {
+        assert_non_null(formatter_stack[formatter_index]);
+        assert_string_equal(detailCaption, expected[i][0]);
+        assert_string_equal(detailValue, expected[i][1]);
+        formatter_index++;
+        if (formatter_stack[formatter_index] != NULL) {
+            set_state_data(true);
+        }
+    }
+    assert_null(formatter_stack[formatter_index]);
+}
+
 int main() {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_transactions),
+        cmocka_unit_test(test_multi_path_signing_keys),
+        cmocka_unit_test(test_batch_hash_screens),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }